@@ -0,0 +1,94 @@
+#ifndef BITMATRIX_H
+#define BITMATRIX_H
+
+#include <stdint.h>
+#include <vector>
+
+//A rows x cols matrix of bits held in a single array. Each row is a whole number of 64-bit words (rowWords()), so a
+//row can be used as a bitset and two rows can be compared a word at a time. Bits past the last column are always zero
+class BitMatrix {
+public:
+	BitMatrix() : numRows(0), numCols(0), words(0) {}
+
+	void assign(int rows, int cols) {
+		//Makes the matrix rows x cols with every bit zero
+		numRows = rows;
+		numCols = cols;
+		words = wordsFor(cols);
+		bits.assign(size_t(rows) * words, 0);
+	}
+
+	void resize(int rows, int cols) {
+		//Changes the size of the matrix, keeping the bits that are in both the old and new matrix. New bits are zero
+		int i, j, newWords = wordsFor(cols);
+		if (newWords == words) {
+			bits.resize(size_t(rows) * words, 0);
+			if (cols < numCols) for (i = 0; i < rows; i++) for (j = cols; j < numCols; j++) set(i, j, false);
+		}
+		else {
+			std::vector<uint64_t> old(size_t(rows) * newWords, 0);
+			old.swap(bits);
+			for (i = 0; i < rows && i < numRows; i++) {
+				for (j = 0; j < cols && j < numCols; j++) {
+					if ((old[size_t(i) * words + (j >> 6)] >> (j & 63)) & 1) bits[size_t(i) * newWords + (j >> 6)] |= uint64_t(1) << (j & 63);
+				}
+			}
+		}
+		numRows = rows;
+		numCols = cols;
+		words = newWords;
+	}
+
+	inline bool operator()(int i, int j) const {
+		return (bits[size_t(i) * words + (j >> 6)] >> (j & 63)) & 1;
+	}
+
+	inline void set(int i, int j, bool val) {
+		uint64_t &w = bits[size_t(i) * words + (j >> 6)];
+		if (val) w |= uint64_t(1) << (j & 63);
+		else w &= ~(uint64_t(1) << (j & 63));
+	}
+
+	void clearRow(int i) {
+		for (int w = 0; w < words; w++) bits[size_t(i) * words + w] = 0;
+	}
+
+	bool rowsIntersect(int i, int j) const {
+		//True if rows i and j have a one in the same column
+		const uint64_t *a = row(i), *b = row(j);
+		for (int w = 0; w < words; w++) if (a[w] & b[w]) return true;
+		return false;
+	}
+
+	void eraseRow(int i) {
+		bits.erase(bits.begin() + size_t(i) * words, bits.begin() + size_t(i + 1) * words);
+		numRows--;
+	}
+
+	void eraseCol(int j) {
+		//Removes column j, moving the later columns of each row one place to the left
+		for (int i = 0; i < numRows; i++) {
+			for (int c = j; c < numCols - 1; c++) set(i, c, (*this)(i, c + 1));
+			set(i, numCols - 1, false);
+		}
+		resize(numRows, numCols - 1);
+	}
+
+	inline const uint64_t *row(int i) const { return bits.data() + size_t(i) * words; }
+	inline uint64_t *row(int i) { return bits.data() + size_t(i) * words; }
+	inline int rows() const { return numRows; }
+	inline int cols() const { return numCols; }
+	inline int rowWords() const { return words; }
+
+private:
+	int numRows;
+	int numCols;
+	int words;
+	std::vector<uint64_t> bits;
+
+	static int wordsFor(int cols) {
+		return (cols + 63) / 64;
+	}
+};
+
+#endif //BITMATRIX_H
@@ -1,24 +1,5 @@
 #include "bpp.h"
 
-extern vector<STOP> stops;
-extern vector<ADDR> addresses;
-extern vector<bool> isOutlier;
-extern vector<vector<double> > dDist;
-extern vector<vector<double> > dTime;
-extern vector<vector<double> > wDist;
-extern vector<vector<double> > wTime;
-extern vector<vector<int> > stopAdjList;
-extern vector<vector<int> > addrAdjList;
-extern vector<vector<bool> > addrStopAdj;
-extern int totalPassengers, maxBusCapacity;
-extern double maxWalkDist;
-extern double minEligibilityDist;
-extern string distUnits;
-extern double dwellPerPassenger;
-extern double dwellPerStop;
-extern double excessWeight;
-extern double maxJourneyTime;
-
 void swapVals(int &x, int &y) {
 	int z = x; x = y; y = z;
 }
@@ -42,7 +23,7 @@ int getLargestItem(vector<int> &itemWeight) {
 	return maxPos;
 }
 
-int posOfItemInBin(int item, vector<int> &items) {
+int posOfItemInBin(int item, RaggedArray<int>::ConstRow items) {
 	//Tells us the position of "item" in an array. Returns -1 if it isn't present
 	int i;
 	for (i = 0; i < items.size(); i++) {
@@ -51,7 +32,7 @@ int posOfItemInBin(int item, vector<int> &items) {
 	return -1;
 }
 
-int chooseBinWithEnoughCapacity(vector<int> &binWeight, vector<vector<int> > &items, int v, int weightv, int &posOfV) {
+int chooseBinWithEnoughCapacity(int maxBusCapacity, vector<int> &binWeight, RaggedArray<int> &items, int v, int weightv, int &posOfV) {
 	//Find the most suitable bin for item v. Do this by returning the first bin that has with adequate capacity 
 	//and that already contains v. If such a bin does not exist, return the first bin with adequate capacity that 
 	//does not contain v. Return -1 if neither exists.
@@ -72,7 +53,7 @@ int chooseBinWithEnoughCapacity(vector<int> &binWeight, vector<vector<int> > &it
 	return binNoMultiStop;
 }
 
-int chooseEmptiestBin(vector<int> &binWeight, vector<vector<int> > &items, int v, int weightv, int &posOfV) {
+int chooseEmptiestBin(int maxBusCapacity, vector<int> &binWeight, RaggedArray<int> &items, int v, int weightv, int &posOfV) {
 	//This is used when no bin has adequate capacity. We therefore choose the emptiest bin that already contains v.
 	//If none exists, just choose the emptiest bin. Assumes all bin weights are <= maxBusCapacity
 	int i, k = binWeight.size(), minMulti = maxBusCapacity, minNoMulti = maxBusCapacity, minMultiPos = -1, minNoMultiPos = -1, pos;
@@ -101,14 +82,15 @@ int chooseEmptiestBin(vector<int> &binWeight, vector<vector<int> > &items, int v
 	}
 }
 
-void binPacker(vector<vector<int> > &items, vector<vector<int> > &W, vector<int> &binSize, vector<int> &itemsToAdd, vector<int> &itemsToAddWeight) {
+void binPacker(const SolverContext &ctx, RaggedArray<int> &items, RaggedArray<int> &W, vector<int> &binSize, vector<int> &itemsToAdd, vector<int> &itemsToAddWeight) {
+	const int maxBusCapacity = ctx.maxBusCapacity;
 	//Generates an assignment of stops to buses / routes using BPP heuristics
 	int pos, bin, spare, j;
 	//Call the FFD-style BPP algorithm
 	while (!itemsToAdd.empty()) {
 		//Identify the largest item and search for a suitable bin
 		pos = getLargestItem(itemsToAddWeight);
-		bin = chooseBinWithEnoughCapacity(binSize, items, itemsToAdd[pos], itemsToAddWeight[pos], j);
+		bin = chooseBinWithEnoughCapacity(maxBusCapacity, binSize, items, itemsToAdd[pos], itemsToAddWeight[pos], j);
 		if (bin != -1) {
 			//Bin with adequate capacity found. Assign item to bin and remove it from the itemWeight and itemLabel list.
 			//If the item is already in the bin (j != -1), merge them, else just add it to the end
@@ -125,7 +107,7 @@ void binPacker(vector<vector<int> > &items, vector<vector<int> > &W, vector<int>
 		else {
 			//No single bin can accommodate the item, so use the bin with the most spare capacity for some of it
 			//Again, if the item is already in the bin, merge them, else just add it to the end
-			bin = chooseEmptiestBin(binSize, items, itemsToAdd[pos], itemsToAddWeight[pos], j);
+			bin = chooseEmptiestBin(maxBusCapacity, binSize, items, itemsToAdd[pos], itemsToAddWeight[pos], j);
 			spare = maxBusCapacity - binSize[bin];
 			if (j == -1) {
 				items[bin].push_back(itemsToAdd[pos]);
@@ -140,12 +122,13 @@ void binPacker(vector<vector<int> > &items, vector<vector<int> > &W, vector<int>
 	}
 }
 
-void binPacker(vector<vector<int> > &items, vector<vector<int> > &W, vector<int> &binSize, int itemToPack, int itemToPackSize) {
+void binPacker(const SolverContext &ctx, RaggedArray<int> &items, RaggedArray<int> &W, vector<int> &binSize, int itemToPack, int itemToPackSize) {
+	const int maxBusCapacity = ctx.maxBusCapacity;
 	//Overloaded version of the above that packs just one item (bus stop)
 	int bin, spare, j;
 	while (true) {
 		//Find a suitable bin
-		bin = chooseBinWithEnoughCapacity(binSize, items, itemToPack, itemToPackSize, j);
+		bin = chooseBinWithEnoughCapacity(maxBusCapacity, binSize, items, itemToPack, itemToPackSize, j);
 		if (bin != -1) {
 			//Assign item to bin i. (If the item is already in bin i, merge them)
 			if (j == -1) {
@@ -160,7 +143,7 @@ void binPacker(vector<vector<int> > &items, vector<vector<int> > &W, vector<int>
 		}
 		else {
 			//No single bin can accommodate the item, so use the bin with the most spare capacity for some of it
-			bin = chooseEmptiestBin(binSize, items, itemToPack, itemToPackSize, j);
+			bin = chooseEmptiestBin(maxBusCapacity, binSize, items, itemToPack, itemToPackSize, j);
 			spare = maxBusCapacity - binSize[bin];
 			j = posOfItemInBin(itemToPack, items[bin]);
 			if (j == -1) {
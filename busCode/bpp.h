@@ -3,7 +3,7 @@
 
 #include "main.h"
 
-void binPacker(vector<vector<int> > &items, vector<vector<int> > &W, vector<int> &binSize, vector<int> &itemsToAdd, vector<int> &itemsToAddWeight);
-void binPacker(vector<vector<int> > &items, vector<vector<int> > &W, vector<int> &binSize, int itemToPack, int itemToPackSize);
+void binPacker(const SolverContext &ctx, RaggedArray<int> &items, RaggedArray<int> &W, vector<int> &binSize, vector<int> &itemsToAdd, vector<int> &itemsToAddWeight);
+void binPacker(const SolverContext &ctx, RaggedArray<int> &items, RaggedArray<int> &W, vector<int> &binSize, int itemToPack, int itemToPackSize);
 
 #endif //BPP
@@ -0,0 +1,76 @@
+#ifndef BUCKETQUEUE_H
+#define BUCKETQUEUE_H
+
+#include <vector>
+
+//A max priority queue of items 0,...,(numItems - 1) with small non-negative integer keys. Items with the same key are
+//kept together in a bucket, so the items with the largest key can be read off directly, and an item's key can be
+//lowered by one in O(1) time. Only items with a key greater than zero are held; an item whose key reaches zero leaves
+//the queue. Used by the greedy set covering procedure, where the key is the number of uncovered addresses at a stop
+class BucketQueue {
+public:
+	BucketQueue() : top(0) {}
+
+	void assign(int numItems, int maxKey) {
+		//Empties the queue, making room for items 0,...,(numItems - 1) with keys of up to maxKey
+		int b;
+		key.assign(numItems, 0);
+		pos.assign(numItems, -1);
+		if (buckets.size() < size_t(maxKey + 1)) buckets.resize(maxKey + 1);
+		for (b = 0; b < buckets.size(); b++) buckets[b].clear();
+		top = 0;
+	}
+
+	void insert(int item, int k) {
+		//Adds item (which must not be in the queue) with key k. Nothing is done if k is zero
+		if (k <= 0) return;
+		key[item] = k;
+		pos[item] = buckets[k].size();
+		buckets[k].push_back(item);
+		if (k > top) top = k;
+	}
+
+	void decrement(int item) {
+		//Lowers the key of item by one. Nothing is done if item is not in the queue
+		int k = key[item];
+		if (k <= 0) return;
+		removeFromBucket(item);
+		key[item] = k - 1;
+		if (k > 1) {
+			pos[item] = buckets[k - 1].size();
+			buckets[k - 1].push_back(item);
+		}
+	}
+
+	void remove(int item) {
+		//Takes item out of the queue
+		if (key[item] <= 0) return;
+		removeFromBucket(item);
+		key[item] = 0;
+	}
+
+	inline int maxKey() {
+		//Largest key in the queue (zero if it is empty)
+		while (top > 0 && buckets[top].empty()) top--;
+		return top;
+	}
+
+	inline const std::vector<int> &bucket(int k) const { return buckets[k]; }
+
+private:
+	std::vector<int> key;					//Key of each item (zero if the item is not in the queue)
+	std::vector<int> pos;					//Position of each item in its bucket
+	std::vector<std::vector<int> > buckets;	//Items with each key, in no particular order
+	int top;								//No bucket above this one is occupied
+
+	void removeFromBucket(int item) {
+		std::vector<int> &B = buckets[key[item]];
+		int p = pos[item];
+		B[p] = B.back();
+		pos[B[p]] = p;
+		B.pop_back();
+		pos[item] = -1;
+	}
+};
+
+#endif //BUCKETQUEUE_H
@@ -0,0 +1,190 @@
+#ifndef BUSBIN_H
+#define BUSBIN_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+//Layout of the binary (.busbin) version of a .bus problem file. The file is designed to be memory mapped
+//and its numeric blocks used in place: every block starts on a 64-byte boundary and each row of the two
+//stop-to-stop matrices is padded to a whole number of cache lines (rowStride doubles). All values are
+//stored in the byte order of the machine that wrote the file (checked using endianTag).
+//
+//  BUSBINHEADER
+//  BUSBINSTOP[numStops]
+//  BUSBINADDR[numAddresses]
+//  double[numStops][rowStride]		Driving distances (dDist)
+//  double[numStops][rowStride]		Driving times (dTime)
+//  BUSBINWALK[numWalks]			Walking pairs, in ascending order of address
+//  char[labelsSize]				Names of the stops and addresses (not null terminated)
+
+#define BUSBIN_MAGIC "SBRPBIN"
+#define BUSBIN_VERSION 1
+#define BUSBIN_ENDIAN_TAG 0x01020304u
+#define BUSBIN_ALIGN 64
+
+struct BUSBINHEADER {
+	char magic[8];					//BUSBIN_MAGIC, null terminated
+	uint32_t version;				//BUSBIN_VERSION
+	uint32_t endianTag;				//BUSBIN_ENDIAN_TAG
+	uint32_t numStops;				//Number of stops (stop 0 is the school)
+	uint32_t numAddresses;			//Number of addresses
+	uint32_t numWalks;				//Number of address-stop walking pairs
+	uint32_t rowStride;				//Number of doubles in each (padded) row of the dDist and dTime blocks
+	char distUnits;					//'K' for kms, 'M' for miles
+	char reserved[7];
+	double minEligibilityDist;
+	double maxWalkDist;
+	uint64_t offStops;				//Byte offsets of each block from the start of the file
+	uint64_t offAddresses;
+	uint64_t offDDist;
+	uint64_t offDTime;
+	uint64_t offWalks;
+	uint64_t offLabels;
+	uint64_t labelsSize;
+	uint64_t fileSize;
+};
+
+struct BUSBINSTOP {
+	double x;						//Longitude
+	double y;						//Lattitude
+	uint32_t labelOff;				//Position of the stop's name in the labels block
+	uint32_t labelLen;
+};
+
+struct BUSBINADDR {
+	double x;						//Longitude
+	double y;						//Lattitude
+	int32_t numPass;				//Number of passengers
+	uint32_t labelOff;				//Position of the address's name in the labels block
+	uint32_t labelLen;
+	uint32_t reserved;
+};
+
+struct BUSBINWALK {
+	int32_t addr;
+	int32_t stop;
+	double dist;
+	double time;
+};
+
+inline uint64_t busBinAlign(uint64_t x) {
+	//Rounds x up to the next multiple of BUSBIN_ALIGN
+	return (x + BUSBIN_ALIGN - 1) / BUSBIN_ALIGN * BUSBIN_ALIGN;
+}
+
+inline uint32_t busBinRowStride(uint32_t numStops) {
+	//Number of doubles in each row of a stop-to-stop matrix, padded to whole cache lines
+	uint32_t perLine = BUSBIN_ALIGN / sizeof(double);
+	return (numStops + perLine - 1) / perLine * perLine;
+}
+
+//Builds a .busbin file in memory and writes it out. Used by the converters in busprobs and busprobs_2: the records
+//are filled in using the set functions (walks in ascending order of address), then write() lays out the blocks
+class BusBinWriter {
+public:
+	BusBinWriter(int numStops, int numAddresses, char distUnits, double minEligibilityDist, double maxWalkDist) {
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, BUSBIN_MAGIC, sizeof(BUSBIN_MAGIC));
+		h.version = BUSBIN_VERSION;
+		h.endianTag = BUSBIN_ENDIAN_TAG;
+		h.numStops = numStops;
+		h.numAddresses = numAddresses;
+		h.rowStride = busBinRowStride(numStops);
+		h.distUnits = distUnits == 'K' ? 'K' : 'M';
+		h.minEligibilityDist = minEligibilityDist;
+		h.maxWalkDist = maxWalkDist;
+		stops.resize(numStops);
+		addrs.resize(numAddresses);
+		stopLabels.resize(numStops);
+		addrLabels.resize(numAddresses);
+		dDist.assign((size_t)numStops * h.rowStride, 0.0);
+		dTime.assign((size_t)numStops * h.rowStride, 0.0);
+	}
+
+	void setStop(int i, double x, double y, const char *name) {
+		stops[i].x = x;
+		stops[i].y = y;
+		stopLabels[i] = trimLabel(name);
+	}
+
+	void setAddress(int i, double x, double y, int numPass, const char *name) {
+		addrs[i].x = x;
+		addrs[i].y = y;
+		addrs[i].numPass = numPass;
+		addrLabels[i] = trimLabel(name);
+	}
+
+	void setDrive(int i, int j, double dist, double time) {
+		dDist[(size_t)i * h.rowStride + j] = dist;
+		dTime[(size_t)i * h.rowStride + j] = time;
+	}
+
+	void addWalk(int addr, int stop, double dist, double time) {
+		BUSBINWALK w = {addr, stop, dist, time};
+		walks.push_back(w);
+	}
+
+	bool write(const char *fileName) {
+		//Returns false if the file could not be written
+		size_t i;
+		std::string labels;
+		for (i = 0; i < stops.size(); i++) {
+			stops[i].labelOff = labels.size();
+			stops[i].labelLen = stopLabels[i].size();
+			labels += stopLabels[i];
+		}
+		for (i = 0; i < addrs.size(); i++) {
+			addrs[i].labelOff = labels.size();
+			addrs[i].labelLen = addrLabels[i].size();
+			labels += addrLabels[i];
+		}
+		h.numWalks = walks.size();
+		h.offStops = busBinAlign(sizeof(h));
+		h.offAddresses = busBinAlign(h.offStops + stops.size() * sizeof(BUSBINSTOP));
+		h.offDDist = busBinAlign(h.offAddresses + addrs.size() * sizeof(BUSBINADDR));
+		h.offDTime = busBinAlign(h.offDDist + dDist.size() * sizeof(double));
+		h.offWalks = busBinAlign(h.offDTime + dTime.size() * sizeof(double));
+		h.offLabels = busBinAlign(h.offWalks + walks.size() * sizeof(BUSBINWALK));
+		h.labelsSize = labels.size();
+		h.fileSize = h.offLabels + h.labelsSize;
+
+		FILE *f = fopen(fileName, "wb");
+		if (f == NULL) return false;
+		put(f, 0, &h, sizeof(h));
+		put(f, h.offStops, stops.data(), stops.size() * sizeof(BUSBINSTOP));
+		put(f, h.offAddresses, addrs.data(), addrs.size() * sizeof(BUSBINADDR));
+		put(f, h.offDDist, dDist.data(), dDist.size() * sizeof(double));
+		put(f, h.offDTime, dTime.data(), dTime.size() * sizeof(double));
+		put(f, h.offWalks, walks.data(), walks.size() * sizeof(BUSBINWALK));
+		put(f, h.offLabels, labels.data(), labels.size());
+		bool ok = !ferror(f);
+		fclose(f);
+		return ok;
+	}
+
+private:
+	BUSBINHEADER h;
+	std::vector<BUSBINSTOP> stops;
+	std::vector<BUSBINADDR> addrs;
+	std::vector<BUSBINWALK> walks;
+	std::vector<std::string> stopLabels, addrLabels;
+	std::vector<double> dDist, dTime;		//Padded to rowStride, as in the file
+
+	static std::string trimLabel(const char *name) {
+		//Strips whitespace and commas from both ends of a name, as the solver does when reading a .bus file
+		std::string s(name);
+		size_t l = s.find_first_not_of(" ,\t\r"), r = s.find_last_not_of(" ,\t\r");
+		if (l == std::string::npos) return "";
+		return s.substr(l, r - l + 1);
+	}
+
+	static void put(FILE *f, uint64_t off, const void *data, size_t size) {
+		fseek(f, off, SEEK_SET);
+		if (size) fwrite(data, 1, size, f);
+	}
+};
+
+#endif //BUSBIN_H
@@ -1,25 +1,5 @@
 #include "fns.h"
 
-extern vector<STOP> stops;
-extern vector<ADDR> addresses;
-extern vector<bool> isOutlier;
-extern vector<vector<double> > dDist;
-extern vector<vector<double> > dTime;
-extern vector<vector<double> > wDist;
-extern vector<vector<double> > wTime;
-extern vector<vector<int> > stopAdjList;
-extern vector<vector<int> > addrAdjList;
-extern vector<vector<bool> > addrStopAdj;
-extern int totalPassengers, maxBusCapacity, kInit;
-extern double maxWalkDist;
-extern double minEligibilityDist;
-extern string distUnits;
-extern double dwellPerPassenger;
-extern double dwellPerStop;
-extern double excessWeight;
-extern double maxJourneyTime;
-extern bool useMinCoverings;
-
 inline
 void swapVals(double &x, double &y) {
 	double z; z = x; x = y; y = z;
@@ -30,12 +10,12 @@ void swapVals(int &x, int &y) {
 	int z; z = x; x = y; y = z;
 }
 
-void randPermute(vector<int> &A) {
+void randPermute(SolverContext &ctx, vector<int> &A) {
 	//Randomly permutes the contents of an array A
 	if (A.empty()) return;
 	int i, r;
 	for (i = A.size() - 1; i >= 0; i--) {
-		r = rand() % (i + 1);
+		r = ctx.randInt(i + 1);
 		swap(A[i], A[r]);
 	}
 }
@@ -53,53 +33,89 @@ bool approxEqual(double x, double y) {
 	else return false;
 }
 
-double calcDwellTime(int numPass) {
+double calcDwellTime(const SolverContext &ctx, int numPass) {
 	//Uses the length of a route l to calculate its cost
-	return dwellPerStop + numPass * dwellPerPassenger;
+	return ctx.dwellPerStop + numPass * ctx.dwellPerPassenger;
 }
 
-double calcRCost(double l) {
+double calcRCost(const SolverContext &ctx, double l) {
 	//Uses the length of a route l to calculate its cost
-	if (l > maxJourneyTime) return maxJourneyTime + excessWeight * (l - maxJourneyTime + 1);
+	if (l > ctx.maxJourneyTime) return ctx.maxJourneyTime + ctx.excessWeight * (l - ctx.maxJourneyTime + 1);
 	else return l;
 }
 
-double calcRouteLenFromScratch(SOL &S, int route) {
+double calcRouteLenFromScratch(const SolverContext &ctx, SOL &S, int route) {
 	//Calculates the total time to traverse in a particular route using only items and W
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
 	if (S.items[route].empty()) return 0.0;
 	int i;
 	double total = 0.0;
 	for (i = 0; i < S.items[route].size() - 1; i++) {
-		total += calcDwellTime(S.W[route][i]) + dTime[S.items[route][i]][S.items[route][i + 1]];
+		total += calcDwellTime(ctx, S.W[route][i]) + dTime(S.items[route][i], S.items[route][i + 1]);
 	}
-	total += calcDwellTime(S.W[route][i]) + dTime[S.items[route][i]][0];
+	total += calcDwellTime(ctx, S.W[route][i]) + dTime(S.items[route][i], 0);
 	return total;
 }
 
-double calcSolCostFromScratch(SOL &S) {
+void calcRoutePrefixes(const SolverContext &ctx, SOL &S, int route, int from) {
+	//Rebuilds the prefix sums of route's travel times, dwell times and passengers. Any section's totals then take O(1) time.
+	//Positions before from are unchanged since the sums were last built, so their entries are kept
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
+	RaggedArray<int>::ConstRow R = S.items[route];
+	int i, n = R.size();
+	S.travelPre[route].resize(n);
+	S.travelPreF[route].resize(n);
+	S.dwellPre[route].resize(n + 1);
+	S.passPre[route].resize(n + 1);
+	S.dwellPre[route][0] = 0.0;
+	S.passPre[route][0] = 0;
+	for (i = from; i < n; i++) {
+		if (i == 0) {
+			S.travelPre[route][0] = 0.0;
+			S.travelPreF[route][0] = 0.0;
+		}
+		else {
+			S.travelPre[route][i] = S.travelPre[route][i - 1] + dTime(R[i - 1], R[i]);
+			S.travelPreF[route][i] = S.travelPreF[route][i - 1] + dTime(R[i], R[i - 1]);
+		}
+		S.dwellPre[route][i + 1] = S.dwellPre[route][i] + calcDwellTime(ctx, S.W[route][i]);
+		S.passPre[route][i + 1] = S.passPre[route][i] + S.W[route][i];
+	}
+}
+
+double calcRouteLenFromPrefixes(const SolverContext &ctx, const SOL &S, int route) {
+	//As calcRouteLenFromScratch(), but read off the ends of the route's prefix sums in O(1). These must be up to date
+	int n = S.items[route].size();
+	if (n == 0) return 0.0;
+	return S.travelPre[route][n - 1] + S.dwellPre[route][n] + ctx.inst->dTime(S.items[route][n - 1], 0);
+}
+
+double calcSolCostFromScratch(const SolverContext &ctx, SOL &S) {
 	int i;
 	double tCst = 0, cst;
 	for (i = 0; i < S.items.size(); i++) {
-		cst = calcRCost(calcRouteLenFromScratch(S, i));
+		cst = calcRCost(ctx, calcRouteLenFromScratch(ctx, S, i));
 		tCst += cst;
 	}
 	return tCst;
 }
 
-bool containsOutlierStop(vector<int> &R) {
+bool containsOutlierStop(const SolverContext &ctx, RaggedArray<int>::ConstRow R) {
 	//Returns true if route R contains an outlier stop
 	for (int i = 0; i < R.size(); i++) {
-		if (isOutlier[R[i]]) return true;
+		if (ctx.isOutlier[R[i]]) return true;
 	}
 	return false;
 }
 
-double calcWalkCostFromScratch(SOL &S) {
+double calcWalkCostFromScratch(const SolverContext &ctx, SOL &S) {
 	//Takes a solution S and calculates its walkCost (each student walking to closest used stop)
+	const vector<ADDR> &addresses = ctx.inst->addresses;
+	const WALKS &walks = ctx.inst->walks;
 	int i;
 	double total = 0;
 	for (i = 0; i < addresses.size(); i++) {
-		total += addresses[i].numPass * wTime[i][S.assignedTo[i]];
+		total += addresses[i].numPass * walks.timeTo(i, S.assignedTo[i]);
 	}
 	return total;
 }
@@ -109,7 +125,7 @@ int calcWSum(SOL &S, int v) {
 	int i, r, c, total = 0;
 	for (i = 0; i < S.routeOfStop[v].size(); i++) {
 		r = S.routeOfStop[v][i];
-		c = S.posInRoute[v][r];
+		c = S.posInRoute.get(v, r);
 		total += S.W[r][c];
 	}
 	return total;
@@ -146,13 +162,13 @@ double roundDown(double x, double base) {
 }
 
 //-------------- Some procedures for checking and validating a solution --------------------------------
-void prettyPrintSol(SOL &S) {
+void prettyPrintSol(const SolverContext &ctx, SOL &S) {
 	int i, j;
 	double tLen = 0, len, cst, tCst = 0;
 	cout << "Rte    Act.-Len   Claim-len  Act-Cost  numPass\n";
 	for (i = 0; i < S.items.size(); i++) {
-		len = calcRouteLenFromScratch(S, i);
-		cst = calcRCost(len);
+		len = calcRouteLenFromScratch(ctx, S, i);
+		cst = calcRCost(ctx, len);
 		cout << setw(3) << i << setw(12) << len << setw(12) << S.routeLen[i] << setw(10) << cst << setw(9) << S.passInRoute[i] << "\t";
 		if (S.items[i].empty()) cout << "-\n";
 		else {
@@ -166,11 +182,12 @@ void prettyPrintSol(SOL &S) {
 	cout << "Actual Total Len = " << tLen << endl << "Actual Total Cost = " << tCst << endl << endl;
 }
 
-void checkCoveringIsMinimal(SOL &S, bool &OK) {
+void checkCoveringIsMinimal(const SolverContext &ctx, SOL &S, bool &OK) {
 	//This checks the covering defined by stopUsed is minimal (i.e. that the removal of any stop causes
 	//at least one address to not be served).
 	//First, for each address count the number of adjacent stops in the solution and put this info in Y
-	vector<int> Y(addresses.size(), 0);
+	const vector<vector<int> > &stopAdjList = ctx.inst->stopAdjList;
+	vector<int> Y(ctx.inst->addresses.size(), 0);
 	int i, j;
 	for (i = 1; i < S.stopUsed.size(); i++) {
 		if (S.stopUsed[i]) {
@@ -196,7 +213,8 @@ void checkCoveringIsMinimal(SOL &S, bool &OK) {
 }
 
 bool existsCommonStop(SOL &S, int r1, int r2) {
-	//Returns true if routes r1 and r2 have a common stop, false otherwise
+	//Returns true if routes r1 and r2 have a common stop, false otherwise. (Worked out from S.items, so that it can be used
+	//to check S.commonStop)
 	int i, j;
 	for (i = 0; i < S.items[r1].size(); i++) {
 		for (j = 0; j < S.items[r2].size(); j++) {
@@ -206,16 +224,18 @@ bool existsCommonStop(SOL &S, int r1, int r2) {
 	return false;
 }
 
-bool contains(vector<int> &A, int x) {
+bool contains(RaggedArray<int>::ConstRow A, int x) {
 	//Returns true iff x is an element in A
 	for (int i = 0; i < A.size(); i++)
 		if (A[i] == x) return true;
 	return false;
 }
 
-void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
+void checkSolutionValidity(const SolverContext &ctx, SOL &S, bool shouldBeMinimal) {
 	//Performs a number of checks on a solution to see if it is valid and its cost values match those claimed.
-	int i, j, n = stops.size(), m = addresses.size(), passInRoute = 0, totalNumPass = 0, numUsedStops = 0, solSize = 0;
+	const Instance &inst = *ctx.inst;
+	const WALKS &walks = inst.walks;
+	int i, j, n = inst.stops.size(), m = inst.addresses.size(), passInRoute = 0, totalNumPass = 0, numUsedStops = 0, solSize = 0;
 	double timeToClosestStop;
 	bool OK = true;
 	vector<bool> used(n, false);
@@ -255,7 +275,7 @@ void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
 	//Check the validity of the routeOfStop array (both ways)
 	for (i = 0; i < S.items.size(); i++) {
 		for (j = 0; j < S.items[i].size(); j++) {
-			if (!contains(S.routeOfStop[S.items[i][j]], i)) {
+			if (find(S.routeOfStop[S.items[i][j]].begin(), S.routeOfStop[S.items[i][j]].end(), i) == S.routeOfStop[S.items[i][j]].end()) {
 				cout << "Error: S.routeOfStop and S.items are inconsistent (a) for (stop " << S.items[i][j] << ")\n";
 				OK = false;
 			}
@@ -269,30 +289,42 @@ void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
 			}
 		}
 	}
-	//Also check the validity of the commonStops matrix
+	//Also check the validity of the routeStops and commonStops matrices
+	if (S.routeStops.rows() != S.items.size() || S.commonStop.rows() != S.items.size() || S.commonStop.cols() != S.items.size()) {
+		cout << "Error: S.routeStops or S.commonStop is the wrong size\n";
+		OK = false;
+	}
+	for (i = 0; i < S.routeStops.rows(); i++) {
+		for (j = 0; j < S.routeStops.cols(); j++) {
+			if (S.routeStops(i, j) != (j < S.posInRoute.numStops() && S.posInRoute.get(j, i) != -1)) {
+				cout << "Error S.routeStops is not consistent with S.items\n";
+				OK = false;
+			}
+		}
+	}
 	if (S.items.size() > 1) {
-		for (i = 0; i < S.commonStop.size() - 1; i++) {
-			for (j = i + 1; j < S.commonStop[i].size(); j++) {
-				if (S.commonStop[i][j] != S.commonStop[j][i]) {
+		for (i = 0; i < S.commonStop.rows() - 1; i++) {
+			for (j = i + 1; j < S.commonStop.cols(); j++) {
+				if (S.commonStop(i, j) != S.commonStop(j, i)) {
 					cout << "Error: S.commonStop is not symmetric\n";
 					OK = false;
 				}
-				else if (S.commonStop[i][j] != existsCommonStop(S, i, j)) {
+				else if (S.commonStop(i, j) != existsCommonStop(S, i, j)) {
 					cout << "Error S.commonStop and solution are inconsistent\n";
 					OK = false;
 				}
 			}
 		}
 	}
-	//And check the validity of the S.posInRoute matrix
-	for (i = 0; i < S.posInRoute.size(); i++) {
-		for (j = 0; j < S.posInRoute[i].size(); j++) {
-			if (S.posInRoute[i][j] != -1) {
-				if (S.posInRoute[i][j] >= S.items[j].size()) {
+	//And check the validity of the S.posInRoute index
+	for (i = 0; i < S.posInRoute.numStops(); i++) {
+		for (j = 0; j < S.items.size(); j++) {
+			if (S.posInRoute.get(i, j) != -1) {
+				if (S.posInRoute.get(i, j) >= S.items[j].size()) {
 					cout << "Error S.posInRoute is not consistent with S.items\n";
 					OK = false;
 				}
-				else if ( S.items[j][S.posInRoute[i][j]] != i) {
+				else if ( S.items[j][S.posInRoute.get(i, j)] != i) {
 					cout << "Error S.posInRoute is not consistent with S.items\n";
 					OK = false;
 				}
@@ -301,7 +333,7 @@ void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
 	}
 	for (i = 0; i < S.items.size(); i++) {
 		for (j = 0; j < S.items[i].size(); j++) {
-			if (S.posInRoute[S.items[i][j]][i] != j) {
+			if (S.posInRoute.get(S.items[i][j], i) != j) {
 				cout << "Error S.posInRoute is not consistent with S.items\n";
 				OK = false;
 			}
@@ -310,7 +342,7 @@ void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
 	//Check that the correct routes contain the outliers (if there are any at all)
 	int outlierRouteCnt = 0;
 	for (i = 0; i < S.items.size(); i++) {
-		if (containsOutlierStop(S.items[i]) == true) {
+		if (containsOutlierStop(ctx, S.items[i]) == true) {
 			outlierRouteCnt++;
 			if (S.hasOutlier[i] == false) {
 				cout << "Error: Route " << i << " is claimed to have an outlier stop, but doesn't\n";
@@ -359,7 +391,7 @@ void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
 		}
 	}
 	//If specified, check that S.stopUsed defines a minimal covering
-	if (shouldBeMinimal && useMinCoverings) checkCoveringIsMinimal(S, OK);
+	if (shouldBeMinimal && ctx.useMinCoverings) checkCoveringIsMinimal(ctx, S, OK);
 	//Check that the number of recorded empty stops is correct
 	int emptyCount = 0;
 	for (i = 0; i < S.items.size(); i++) if (S.items[i].empty()) emptyCount++;
@@ -370,19 +402,19 @@ void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
 	//Check that each address i is assigned to the closest used stop
 	for (i = 0; i < m; i++) {
 		timeToClosestStop = DBL_MAX;
-		//Recall that the addrAdjList structure has, for each address, the adjacent stops in non-descending order of time
-		for (j = 0; j < addrAdjList[i].size(); j++) {
-			if (used[addrAdjList[i][j]]) {
-				timeToClosestStop = wTime[i][addrAdjList[i][j]];
+		//Recall that the walks structure has, for each address, the adjacent stops in non-descending order of time
+		for (j = 0; j < walks.numAdj(i); j++) {
+			if (used[walks.adjStop(i, j)]) {
+				timeToClosestStop = walks.adjTime(i, j);
 				break;
 			}
 		}
-		if (j >= addrAdjList[i].size() || timeToClosestStop == DBL_MAX) {
-			cout << "Error: Address " << i << " does not have a used stop within " << maxWalkDist << distUnits << "\n";
+		if (j >= walks.numAdj(i) || timeToClosestStop == DBL_MAX) {
+			cout << "Error: Address " << i << " does not have a used stop within " << inst.maxWalkDist << inst.distUnits << "\n";
 			OK = false;
 		}
-		else if (addrAdjList[i][j] != S.assignedTo[i] && wTime[i][S.assignedTo[i]] != timeToClosestStop) {
-			cout << "Error: Address " << i << " is assigned to stop " << S.assignedTo[i] << " in the solution (" << wTime[i][S.assignedTo[i]] << "), while the closest available stop is " << addrAdjList[i][j] << "(" << timeToClosestStop << ")\n";
+		else if (walks.adjStop(i, j) != S.assignedTo[i] && walks.timeTo(i, S.assignedTo[i]) != timeToClosestStop) {
+			cout << "Error: Address " << i << " is assigned to stop " << S.assignedTo[i] << " in the solution (" << walks.timeTo(i, S.assignedTo[i]) << "), while the closest available stop is " << walks.adjStop(i, j) << "(" << timeToClosestStop << ")\n";
 			OK = false;
 		}
 	}
@@ -397,13 +429,13 @@ void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
 			cout << "Error: Route " << i << " S.passInRoute value does not match the number calculated manually\n";
 			OK = false;
 		}
-		if (passInRoute > maxBusCapacity) {
-			cout << "Error: Route " << i << " contains " << passInRoute << " passengers, which is more than the allowed maximum of " << maxBusCapacity << "\n";
+		if (passInRoute > ctx.maxBusCapacity) {
+			cout << "Error: Route " << i << " contains " << passInRoute << " passengers, which is more than the allowed maximum of " << ctx.maxBusCapacity << "\n";
 			OK = false;
 		}
 	}
-	if (totalNumPass != totalPassengers) {
-		cout << "Error: Total passengers in S.W (" << totalNumPass << ") does not equal actual total number of passengers (" << totalPassengers << ")\n";
+	if (totalNumPass != inst.totalPassengers) {
+		cout << "Error: Total passengers in S.W (" << totalNumPass << ") does not equal actual total number of passengers (" << inst.totalPassengers << ")\n";
 		OK = false;
 	}
 	//Check that all passengers are served in S
@@ -436,10 +468,10 @@ void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
 	//Check that the claimed route lengths are correct
 	double actualCost = 0.0, actualRouteLen;
 	for (i = 0; i < S.items.size(); i++) {
-		actualRouteLen = calcRouteLenFromScratch(S, i);
-		actualCost += calcRCost(actualRouteLen);
+		actualRouteLen = calcRouteLenFromScratch(ctx, S, i);
+		actualCost += calcRCost(ctx, actualRouteLen);
 		if (!approxEqual(S.routeLen[i], actualRouteLen)) {
-			cout << "Error: Claimed length of Route " << i << " (" << S.routeLen[i] << ") does not match actual cost of " << calcRouteLenFromScratch(S, i) << "\n";
+			cout << "Error: Claimed length of Route " << i << " (" << S.routeLen[i] << ") does not match actual cost of " << calcRouteLenFromScratch(ctx, S, i) << "\n";
 			OK = false;
 		}
 	}
@@ -448,14 +480,14 @@ void checkSolutionValidity(SOL &S, bool shouldBeMinimal) {
 		cout << "Error: Claimed cost of solution (" << S.cost << ") does not match actual cost of " << actualCost << "\n";
 		OK = false;
 	}
-	double actualWalkCost = calcWalkCostFromScratch(S);
+	double actualWalkCost = calcWalkCostFromScratch(ctx, S);
 	if (!approxEqual(S.costWalk, actualWalkCost)) {
 		cout << "Error: Claimed Walking cost of solution (" << S.costWalk << ") does not match actual cost of " << actualWalkCost << "\n";
 		OK = false;
 	}
 	//If there is an error, report it and exit
 	if (!OK) {
-		prettyPrintSol(S);
+		prettyPrintSol(ctx, S);
 		exit(1);
 	}
 }
@@ -467,20 +499,21 @@ void reduceNumBuses(SOL &S, int busesRequired) {
 	while (i < S.items.size()) {
 		if (S.items[i].empty()) {
 			//Delete all information relating to this route
-			S.items.erase(S.items.begin() + i);
-			S.W.erase(S.W.begin() + i);
+			S.items.eraseRow(i);
+			S.W.eraseRow(i);
 			S.routeLen.erase(S.routeLen.begin() + i);
 			S.passInRoute.erase(S.passInRoute.begin() + i);
 			S.hasOutlier.erase(S.hasOutlier.begin() + i);
+			S.travelPre.eraseRow(i);
+			S.travelPreF.eraseRow(i);
+			S.dwellPre.eraseRow(i);
+			S.passPre.eraseRow(i);
 			S.numEmptyRoutes--;
 			S.numFeasibleRoutes--;
-			for (int r = 0; r < S.posInRoute.size(); r++) {
-				S.posInRoute[r].erase(S.posInRoute[r].begin() + i);
-			}
-			for (int r = 0; r < S.commonStop.size(); r++) {
-				S.commonStop[r].erase(S.commonStop[r].begin() + i);
-			}
-			S.commonStop.erase(S.commonStop.begin() + i);
+			S.posInRoute.removeRoute(i);
+			S.routeStops.eraseRow(i);
+			S.commonStop.eraseRow(i);
+			S.commonStop.eraseCol(i);
 		}
 		else i++;
 		if (S.items.size() == busesRequired) break;
@@ -490,62 +523,71 @@ void reduceNumBuses(SOL &S, int busesRequired) {
 	for (i = 0; i < S.items.size(); i++) for (j = 0; j < S.items[i].size(); j++) S.routeOfStop[S.items[i][j]].push_back(i);
 }
 
-void addEmptyRoute(SOL &S) {
+void addEmptyRoute(const SolverContext &ctx, SOL &S) {
 	//Adds a single empty route to the solution S and updates all data structures
-	int i, k = S.items.size();
-	for (i = 0; i < k; i++) S.commonStop[i].push_back(false);
-	S.commonStop.push_back(vector<bool>(k, false));
-	for (i = 1; i < stops.size(); i++) S.posInRoute[i].push_back(-1);
-	S.items.push_back(vector<int>());
-	S.W.push_back(vector<int>());
+	int k = S.items.size();
+	S.routeStops.resize(k + 1, S.routeStops.cols());
+	S.commonStop.resize(k + 1, k + 1);
+	S.items.addRow();
+	S.W.addRow();
 	S.routeLen.push_back(0.0);
 	S.passInRoute.push_back(0);
 	S.hasOutlier.push_back(false);
+	S.travelPre.addRow();
+	S.travelPreF.addRow();
+	S.dwellPre.addRow();
+	S.passPre.addRow();
+	S.dwellPre[k].push_back(0.0);
+	S.passPre[k].push_back(0);
 	S.numEmptyRoutes++;
 	S.numFeasibleRoutes++;
 }
 
 //--------------Some functions for calculating metrics for output----------------------------------------/
-void calcMetrics(double &stopsPerAddr, double &addrPerStop) {
+void calcMetrics(const Instance &inst, double &stopsPerAddr, double &addrPerStop) {
 	//Calculate some metrics for output: First calculate numAddresses per stop and num stops per address
+	const vector<vector<int> > &stopAdjList = inst.stopAdjList;
 	int i, total1 = 0, total2 = 0;
 	stopsPerAddr = addrPerStop = 0.0;
 	for (i = 1; i < stopAdjList.size(); i++) total1 += stopAdjList[i].size();
-	for (i = 0; i < addrAdjList.size(); i++) total2 += addrAdjList[i].size();
+	total2 = inst.walks.stop.size();
 	addrPerStop = total1 / double(stopAdjList.size() - 1);
-	stopsPerAddr = total2 / double(addrAdjList.size());
+	stopsPerAddr = total2 / double(inst.addresses.size());
 }
 
-int calcSingletonStops(SOL &S) {
+int calcSingletonStops(const Instance &inst, SOL &S) {
 	//Calculate the number of stops that are used just once
 	int i, numSingletonStops = 0;
-	for (i = 1; i < stops.size(); i++) {
+	for (i = 1; i < inst.stops.size(); i++) {
 		if (S.routeOfStop[i].size() == 1) numSingletonStops++;
 	}
 	return numSingletonStops;
 }
 
-void getOutliers() {
+void getOutliers(SolverContext &ctx) {
 	//Determines any stops that are compulsory and that are too far from the school 
+	const Instance &inst = *ctx.inst;
+	const vector<STOP> &stops = inst.stops;
+	const FlatMatrix<double> &dTime = inst.dTime;
+	vector<bool> &isOutlier = ctx.isOutlier;
 	int i, j, stus;
 	bool containsOutlier = false;
 	isOutlier.resize(stops.size(), false);
+	//The smallest number of students who will be boarding each stop if it is being used (i.e. the num stus for whom it is their closest stop)
+	vector<int> minBoarding(stops.size(), 0);
+	for (j = 0; j < inst.addresses.size(); j++) minBoarding[inst.walks.adjStop(j, 0)] += inst.addresses[j].numPass;
 	for (i = 1; i < stops.size(); i++) {
-		if (dTime[i][0] > maxJourneyTime) {
+		if (dTime(i, 0) > ctx.maxJourneyTime) {
 			isOutlier[i] = true;
-			cout << "Bus Stop " << i << " = \"" << stops[i].label << "\" is an outlier (" << ceil(dTime[i][0] / 60.0) << " mins from the school)\n";
+			cout << "Bus Stop " << i << " = \"" << stops[i].label << "\" is an outlier (" << ceil(dTime(i, 0) / 60.0) << " mins from the school)\n";
 			containsOutlier = true;
 		}
 		else if (stops[i].required) {
-			//Calculate the smallest number of students who will be boarding stop i if it is being used (i.e. the num stus for whom i is their closest stop)
-			stus = 0;
-			for (j = 0; j < addrAdjList.size(); j++) {
-				if (addrAdjList[j][0] == i) stus += addresses[j].numPass;
-			}
-			//and also check if this makes the stop an outlier
-			if (dTime[i][0] + calcDwellTime(stus) > maxJourneyTime) {
+			//Check if the students who must board stop i make it an outlier
+			stus = minBoarding[i];
+			if (dTime(i, 0) + calcDwellTime(ctx, stus) > ctx.maxJourneyTime) {
 				isOutlier[i] = true;
-				cout << "Bus Stop " << i << " = \"" << stops[i].label << "\" is an outlier (" << ceil(dTime[i][0] / 60.0) << " mins from the school, plus at least " << stus << " students must board here)\n";
+				cout << "Bus Stop " << i << " = \"" << stops[i].label << "\" is an outlier (" << ceil(dTime(i, 0) / 60.0) << " mins from the school, plus at least " << stus << " students must board here)\n";
 				containsOutlier = true;
 			}
 		}
@@ -3,23 +3,25 @@
 
 #include "main.h"
 
-void randPermute(vector<int> &A);
+void randPermute(SolverContext &ctx, vector<int> &A);
 double sumDouble(vector<double> &X);
 bool approxEqual(double x, double y);
-double calcDwellTime(int numPass);
-double calcRCost(double l);
-double calcRouteLenFromScratch(SOL &S, int route);
-double calcSolCostFromScratch(SOL &S);
-double calcWalkCostFromScratch(SOL &S);
+double calcDwellTime(const SolverContext &ctx, int numPass);
+double calcRCost(const SolverContext &ctx, double l);
+double calcRouteLenFromScratch(const SolverContext &ctx, SOL &S, int route);
+void calcRoutePrefixes(const SolverContext &ctx, SOL &S, int route, int from = 0);
+double calcRouteLenFromPrefixes(const SolverContext &ctx, const SOL &S, int route);
+double calcSolCostFromScratch(const SolverContext &ctx, SOL &S);
+double calcWalkCostFromScratch(const SolverContext &ctx, SOL &S);
 int calcWSum(SOL &S, int v);
 double roundUp(double x, double base);
 double roundDown(double x, double base);
 bool existsCommonStop(SOL &S, int r1, int r2);
-bool containsOutlierStop(vector<int> &R);
-void prettyPrintSol(SOL &S);
-void checkSolutionValidity(SOL &S, bool shouldBeMinimal);
-void calcMetrics(double &stopsPerAddr, double &addrPerStop);
-int calcSingletonStops(SOL &S);
-void getOutliers();
+bool containsOutlierStop(const SolverContext &ctx, RaggedArray<int>::ConstRow R);
+void prettyPrintSol(const SolverContext &ctx, SOL &S);
+void checkSolutionValidity(const SolverContext &ctx, SOL &S, bool shouldBeMinimal);
+void calcMetrics(const Instance &inst, double &stopsPerAddr, double &addrPerStop);
+int calcSingletonStops(const Instance &inst, SOL &S);
+void getOutliers(SolverContext &ctx);
 
 #endif //FNS
\ No newline at end of file
@@ -2,33 +2,12 @@
 #include "fns.h"
 #include "setcover.h"
 
-extern vector<STOP> stops;
-extern vector<ADDR> addresses;
-extern vector<bool> isOutlier;
-extern vector<vector<double> > dDist;
-extern vector<vector<double> > dTime;
-extern vector<vector<double> > wDist;
-extern vector<vector<double> > wTime;
-extern vector<vector<int> > stopAdjList;
-extern vector<vector<int> > addrAdjList;
-extern vector<vector<bool> > addrStopAdj;
-extern int totalPassengers, maxBusCapacity;
-extern double maxWalkDist;
-extern double minEligibilityDist;
-extern string distUnits;
-extern double dwellPerPassenger;
-extern double dwellPerStop;
-extern double excessWeight;
-extern double maxJourneyTime;
-
-vector<int> stopsToPack, weightOfStopsToPack;
-
 void eliminateFromW(SOL &S, int v, int x) {
 	//Eliminates x passengers from occurrences of stop v in S.W and updates S.passInRoute
 	int i, r, c;
 	for (i = 0; i < S.routeOfStop[v].size(); i++) {
 		r = S.routeOfStop[v][i];
-		c = S.posInRoute[v][r];
+		c = S.posInRoute.get(v, r);
 		if (x <= S.W[r][c]) {
 			S.passInRoute[r] -= x;
 			S.W[r][c] -= x;
@@ -44,23 +23,26 @@ void eliminateFromW(SOL &S, int v, int x) {
 	exit(1);
 }
 
-void repopulateAuxiliaries(SOL &S) {
+void repopulateAuxiliaries(const SolverContext &ctx, SOL &S) {
 	//This procedure takes a solution defined according to the following structures
 	//S.stopUsed, S.assignedTo, S.numBoarding, S.W, S.items, and S.passInRoute.
 	//It then uses these to repopulate the remaining auxiliary structures (not the costs though)	
+	const vector<STOP> &stops = ctx.inst->stops;
 	int i, j, u, k = S.items.size();
-	S.routeOfStop.clear();
-	S.routeOfStop.resize(stops.size(), vector<int>());
+	S.routeOfStop.assign(stops.size(), 4);
 	S.stopUsed.clear();
 	S.stopUsed.resize(stops.size(), false);
 	S.routeLen.clear();
 	S.routeLen.resize(k, 0.0);
 	S.hasOutlier.clear();
 	S.hasOutlier.resize(k, false);
-	S.posInRoute.clear();
-	S.posInRoute.resize(stops.size(), vector<int>(k, -1));
-	S.commonStop.clear();
-	S.commonStop.resize(k, vector<bool>(k, false));
+	S.posInRoute.assign(stops.size());
+	S.routeStops.assign(k, stops.size());
+	S.commonStop.assign(k, k);
+	S.travelPre.assign(k, 32);
+	S.travelPreF.assign(k, 32);
+	S.dwellPre.assign(k, 32);
+	S.passPre.assign(k, 32);
 	S.numFeasibleRoutes = 0;
 	S.numEmptyRoutes = k;
 	S.numUsedStops = 0;
@@ -77,9 +59,10 @@ void repopulateAuxiliaries(SOL &S) {
 				S.numUsedStops++;
 			}
 			//Calculate stuff to do with outliers
-			if (isOutlier[u]) S.hasOutlier[i] = true;
+			if (ctx.isOutlier[u]) S.hasOutlier[i] = true;
 			//Calculate pos in route
-			S.posInRoute[u][i] = j;
+			S.posInRoute.set(u, i, j);
+			S.routeStops.set(i, u, true);
 			S.routeOfStop[u].push_back(i);
 		}
 	}
@@ -87,32 +70,37 @@ void repopulateAuxiliaries(SOL &S) {
 	if (k > 1) {
 		for (i = 0; i < k - 1; i++) {
 			for (j = i + 1; j < k; j++) {
-				if (existsCommonStop(S, i, j)) {
-					S.commonStop[i][j] = true;
-					S.commonStop[j][i] = true;
+				if (S.routeStops.rowsIntersect(i, j)) {
+					S.commonStop.set(i, j, true);
+					S.commonStop.set(j, i, true);
 				}
 			}
 		}
 	}
 	//Next calculate the raw length of each route (no weightings -- just travel and dwell times) and the num routes containing outliers
 	for (i = 0; i < k; i++) {
-		S.routeLen[i] = calcRouteLenFromScratch(S, i);
+		S.routeLen[i] = calcRouteLenFromScratch(ctx, S, i);
+		calcRoutePrefixes(ctx, S, i);
 		if (!S.items[i].empty()) S.numEmptyRoutes--;
 		if (S.hasOutlier[i]) S.numRoutesWithOutliers++;
-		if (S.routeLen[i] <= maxJourneyTime || S.hasOutlier[i]) S.numFeasibleRoutes++;
+		if (S.routeLen[i] <= ctx.maxJourneyTime || S.hasOutlier[i]) S.numFeasibleRoutes++;
 	}
 }
 
-void makeInitSol(SOL &S, int k, int heuristic) {
+void makeInitSol(SolverContext &ctx, SOL &S, int k, int heuristic) {
 	//For the set covering algorithm a greedy algorithm is used. 
 	//Heuristic: 1: choose set with most uncovered elements at each iteration
 	//           2: choose any set with an uncovered element at each iteration
 	//			 3: This is different, it simply takes the stops closest to each student	
+	const vector<STOP> &stops = ctx.inst->stops;
+	const vector<ADDR> &addresses = ctx.inst->addresses;
+	const WALKS &walks = ctx.inst->walks;
+	vector<int> &stopsToPack = ctx.stopsToPack, &weightOfStopsToPack = ctx.weightOfStopsToPack;
 	int i, j;
 	
 	//Initialise the arrays that define the solution 
-	S.items = vector<vector<int> >(k, vector<int>());
-	S.W = vector<vector<int> >(k, vector<int>());
+	S.items.assign(k, 32);
+	S.W.assign(k, 32);
 	S.stopUsed = vector<bool>(stops.size(), false);
 	S.assignedTo = vector<int>(addresses.size());
 	S.numBoarding = vector<int>(stops.size(), 0);
@@ -120,17 +108,17 @@ void makeInitSol(SOL &S, int k, int heuristic) {
 	
 	if (heuristic != 3) {
 		//Make a minimal covering for the initial set of bus stops
-		generateNewCovering(S.stopUsed, -1, heuristic);
+		generateNewCovering(ctx, S.stopUsed, -1, heuristic);
 	}
 	else {
-		getClosestStops(S.stopUsed);
+		getClosestStops(ctx, S.stopUsed);
 	}
 	
 	//Assign each address to the closest used bus stop
 	for (i = 0; i < addresses.size(); i++) {
-		for (j = 0; j < addrAdjList[i].size(); j++) {
-			if (S.stopUsed[addrAdjList[i][j]]) {
-				S.assignedTo[i] = addrAdjList[i][j];
+		for (j = 0; j < walks.numAdj(i); j++) {
+			if (S.stopUsed[walks.adjStop(i, j)]) {
+				S.assignedTo[i] = walks.adjStop(i, j);
 				break;
 			}
 		}
@@ -138,9 +126,9 @@ void makeInitSol(SOL &S, int k, int heuristic) {
 
 	//Calculate the number boarding at each stop
 	for (i = 0; i < addresses.size(); i++) {
-		for (j = 0; j < addrAdjList[i].size(); j++) {
-			if (S.stopUsed[addrAdjList[i][j]]) {
-				S.numBoarding[addrAdjList[i][j]] += addresses[i].numPass;
+		for (j = 0; j < walks.numAdj(i); j++) {
+			if (S.stopUsed[walks.adjStop(i, j)]) {
+				S.numBoarding[walks.adjStop(i, j)] += addresses[i].numPass;
 				break;
 			}
 		}
@@ -163,24 +151,28 @@ void makeInitSol(SOL &S, int k, int heuristic) {
 			weightOfStopsToPack.push_back(S.numBoarding[i]);
 		}
 	}
-	binPacker(S.items, S.W, S.passInRoute, stopsToPack, weightOfStopsToPack);
+	binPacker(ctx, S.items, S.W, S.passInRoute, stopsToPack, weightOfStopsToPack);
 
 	//Finally, we need to repopulate the residual structures. 
-	repopulateAuxiliaries(S);
+	repopulateAuxiliaries(ctx, S);
 
 	//...and calculate the costs
-	S.cost = calcSolCostFromScratch(S);
-	S.costWalk = calcWalkCostFromScratch(S);
+	S.cost = calcSolCostFromScratch(ctx, S);
+	S.costWalk = calcWalkCostFromScratch(ctx, S);
 }
 
-void rebuildSolution(SOL &S) {
+void rebuildSolution(SolverContext &ctx, SOL &S) {
 	//Takes an existing solution and a new minimal covering of bus stops and adapts the solution accordingly 
+	const vector<STOP> &stops = ctx.inst->stops;
+	const vector<ADDR> &addresses = ctx.inst->addresses;
+	const WALKS &walks = ctx.inst->walks;
+	vector<int> &stopsToPack = ctx.stopsToPack, &weightOfStopsToPack = ctx.weightOfStopsToPack;
 	int i, j, r, c, v, x, k = S.items.size(), excess;
 	//First assign each address to the closest used bus stop
 	for (i = 0; i < addresses.size(); i++) {
-		for (j = 0; j < addrAdjList[i].size(); j++) {
-			if (S.stopUsed[addrAdjList[i][j]]) {
-				S.assignedTo[i] = addrAdjList[i][j];
+		for (j = 0; j < walks.numAdj(i); j++) {
+			if (S.stopUsed[walks.adjStop(i, j)]) {
+				S.assignedTo[i] = walks.adjStop(i, j);
 				break;
 			}
 		}
@@ -189,9 +181,9 @@ void rebuildSolution(SOL &S) {
 	S.numBoarding.clear();
 	S.numBoarding.resize(stops.size(), 0);
 	for (i = 0; i < addresses.size(); i++) {
-		for (j = 0; j < addrAdjList[i].size(); j++) {
-			if (S.stopUsed[addrAdjList[i][j]]) {
-				S.numBoarding[addrAdjList[i][j]] += addresses[i].numPass;
+		for (j = 0; j < walks.numAdj(i); j++) {
+			if (S.stopUsed[walks.adjStop(i, j)]) {
+				S.numBoarding[walks.adjStop(i, j)] += addresses[i].numPass;
 				break;
 			}
 		}
@@ -224,7 +216,7 @@ void rebuildSolution(SOL &S) {
 			//Stop v is not being used now, so set all related S[W]'s to zero and update passInRoute
 			for (i = 0; i < S.routeOfStop[v].size(); i++) {
 				r = S.routeOfStop[v][i];
-				c = S.posInRoute[v][r];
+				c = S.posInRoute.get(v, r);
 				S.passInRoute[r] -= S.W[r][c];
 				S.W[r][c] = 0;
 			}
@@ -242,12 +234,12 @@ void rebuildSolution(SOL &S) {
 		}
 	}
 	//We can now pack the remaining stops into the solution 
-	binPacker(S.items, S.W, S.passInRoute, stopsToPack, weightOfStopsToPack);
+	binPacker(ctx, S.items, S.W, S.passInRoute, stopsToPack, weightOfStopsToPack);
 
 	//Finally, we need to repopulate the residual structures. 
-	repopulateAuxiliaries(S);
+	repopulateAuxiliaries(ctx, S);
 	
 	//...and calculate the costs
-	S.cost = calcSolCostFromScratch(S);
-	S.costWalk = calcWalkCostFromScratch(S);
+	S.cost = calcSolCostFromScratch(ctx, S);
+	S.costWalk = calcWalkCostFromScratch(ctx, S);
 }
\ No newline at end of file
@@ -4,8 +4,8 @@
 #include "main.h"
 
 void eliminateFromW(SOL &S, int v, int x);
-void repopulateAuxiliaries(SOL &S);
-void makeInitSol(SOL &S, int k, int heurisic);
-void rebuildSolution(SOL &S);
+void repopulateAuxiliaries(const SolverContext &ctx, SOL &S);
+void makeInitSol(SolverContext &ctx, SOL &S, int k, int heurisic);
+void rebuildSolution(SolverContext &ctx, SOL &S);
 
 #endif //INITSOL
\ No newline at end of file
@@ -1,48 +1,24 @@
 #include "input.h"
+#include "busbin.h"
 
-extern vector<STOP> stops;
-extern vector<ADDR> addresses;
-extern vector<bool> isOutlier;
-extern vector<vector<double> > dDist;
-extern vector<vector<double> > dTime;
-extern vector<vector<double> > wDist;
-extern vector<vector<double> > wTime;
-extern vector<vector<int> > stopAdjList;
-extern vector<vector<int> > addrAdjList;
-extern vector<vector<bool> > addrStopAdj;
-extern int totalPassengers, maxBusCapacity;
-extern double maxWalkDist;
-extern double minEligibilityDist;
-extern string distUnits;
-extern double dwellPerPassenger;
-extern double dwellPerStop;
-extern double excessWeight;
-extern double maxJourneyTime;
-
-//Functions for sorting an array of stop indexes according to their distance from addr (or stop)
-int partitionStopsByDist(vector<int> &A, int left, int right, int who, int addr) {
-	for (int i = left; i<right; ++i) {
-		if (wTime[addr][A[i]] <= wTime[addr][who]) {
-			swap(A[i], A[left]);
-			left++;
-		}
-	}
-	return left - 1;
-}
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-void qSortStopsByDist(vector<int> &A, int left, int right, int addr) {
-	if (left >= right) return;
-	int middle = left + (right - left) / 2;
-	swap(A[middle], A[left]);
-	int midpoint = partitionStopsByDist(A, left + 1, right, A[left], addr);
-	swap(A[left], A[midpoint]);
-	qSortStopsByDist(A, left, midpoint, addr);
-	qSortStopsByDist(A, midpoint + 1, right, addr);
-}
+struct WALKPAIR {
+	int addr;
+	int stop;
+	double dist;
+	double time;
+};
 
-int partitionAddressesByDist(vector<int> &A, int left, int right, int who, int stop) {
+//Functions for sorting an array of stop (or address) indexes into ascending order of key[index] (walk times)
+int partitionByKey(vector<int> &A, int left, int right, int who, vector<double> &key) {
 	for (int i = left; i<right; ++i) {
-		if (wTime[A[i]][stop] <= wTime[who][stop]) {
+		if (key[A[i]] <= key[who]) {
 			swap(A[i], A[left]);
 			left++;
 		}
@@ -50,16 +26,18 @@ int partitionAddressesByDist(vector<int> &A, int left, int right, int who, int s
 	return left - 1;
 }
 
-void qSortAddressesByDist(vector<int> &A, int left, int right, int stop) {
+void qSortByKey(vector<int> &A, int left, int right, vector<double> &key) {
 	if (left >= right) return;
 	int middle = left + (right - left) / 2;
 	swap(A[middle], A[left]);
-	int midpoint = partitionAddressesByDist(A, left + 1, right, A[left], stop);
+	int midpoint = partitionByKey(A, left + 1, right, A[left], key);
 	swap(A[left], A[midpoint]);
-	qSortAddressesByDist(A, left, midpoint, stop);
-	qSortAddressesByDist(A, midpoint + 1, right, stop);
+	qSortByKey(A, left, midpoint, key);
+	qSortByKey(A, midpoint + 1, right, key);
 }
 
+void buildAdjacencies(Instance &inst, vector<WALKPAIR> &walkPairs);
+
 void trim(string &str) {
 	//Trims any whitespce and commas from the left and right of the string.
 	if (str.length() == 0) return;
@@ -73,11 +51,16 @@ void trim(string &str) {
 	str = str.substr(l, r - l + 1);
 }
 
-void readInput(string &infile) {
+void readInput(Instance &inst, string &infile) {
 	//Reads in the input file
-	int i, j, x, y, numStops, numAddresses, numWalks;
-	double d, t;
+	vector<STOP> &stops = inst.stops;
+	vector<ADDR> &addresses = inst.addresses;
+	FlatMatrix<double> &dDist = inst.dDist;
+	FlatMatrix<double> &dTime = inst.dTime;
+	int &totalPassengers = inst.totalPassengers;
+	int i, j, numStops, numAddresses, numWalks;
 	string temp;
+	vector<WALKPAIR> walkPairs;
 
 	totalPassengers = 0;
 
@@ -93,12 +76,12 @@ void readInput(string &infile) {
 	getline(inStream, temp, ',');
 	numWalks = stoi(temp);
 	getline(inStream, temp, ',');
-	if (temp == "K") distUnits = "kms";
-	else distUnits = "miles";
+	if (temp == "K") inst.distUnits = "kms";
+	else inst.distUnits = "miles";
 	getline(inStream, temp, ',');
-	minEligibilityDist = stof(temp);
+	inst.minEligibilityDist = stof(temp);
 	getline(inStream, temp, ',');
-	maxWalkDist = stof(temp);
+	inst.maxWalkDist = stof(temp);
 	getline(inStream, temp, ',');
 	trim(temp);
 	//Read the rest of the line (doesn't do anything)
@@ -109,10 +92,9 @@ void readInput(string &infile) {
 	//Now resize the arrays
 	stops.resize(numStops);
 	addresses.resize(numAddresses);
-	dTime.resize(numStops, vector<double>(numStops));
-	dDist.resize(numStops, vector<double>(numStops));
-	wTime.resize(numAddresses, vector<double>(numStops, DBL_MAX));
-	wDist.resize(numAddresses, vector<double>(numStops, DBL_MAX));
+	dTime.resize(numStops, numStops, 0.0);
+	dDist.resize(numStops, numStops, 0.0);
+	walkPairs.resize(numWalks);
 	
 	//Now read information about the stops
 	for (i = 0; i < numStops; i++) {
@@ -149,9 +131,9 @@ void readInput(string &infile) {
 			getline(inStream, temp, ',');
 			getline(inStream, temp, ',');
 			getline(inStream, temp, ',');
-			dDist[i][j] = stod(temp);
+			dDist(i, j) = stod(temp);
 			getline(inStream, temp);
-			dTime[i][j] = stod(temp);
+			dTime(i, j) = stod(temp);
 		}
 	}
 
@@ -159,56 +141,363 @@ void readInput(string &infile) {
 	for (i = 0; i < numWalks; i++) {
 		getline(inStream, temp, ',');
 		getline(inStream, temp, ',');
-		x = stoi(temp);
+		walkPairs[i].addr = stoi(temp);
 		getline(inStream, temp, ',');
-		y = stoi(temp);
+		walkPairs[i].stop = stoi(temp);
 		getline(inStream, temp, ',');
-		d = stod(temp);
+		walkPairs[i].dist = stod(temp);
 		getline(inStream, temp);
-		t = stod(temp);
-		wTime[x][y] = t;
-		wDist[x][y] = d;
+		walkPairs[i].time = stod(temp);
 	}
 	inStream.close();
 
-	//We have now read in all the input. 
-	//Now create an Adj list and matrix specifying the stops and addresses that are adjacent (within maximum walking distance)
-	addrStopAdj.resize(addresses.size(), vector<bool>(stops.size(), false));
-	addrAdjList.resize(addresses.size(), vector<int>());
-	for (i = 0; i < addresses.size(); i++) {
-		for (j = 1; j < stops.size(); j++) {
-			if (wDist[i][j] <= maxWalkDist) {
-				addrStopAdj[i][j] = true;
-				addrAdjList[i].push_back(j);
-			}
+	//We have now read in all the input. Now build the adjacency structures
+	buildAdjacencies(inst, walkPairs);
+}
+
+void buildAdjacencies(Instance &inst, vector<WALKPAIR> &walkPairs) {
+	//Uses the walking pairs to determine the stops and addresses that are adjacent (within maximum walking distance).
+	//Walks to the school (stop 0) are ignored and, if a pair is listed more than once, the last listing is used.
+	vector<STOP> &stops = inst.stops;
+	vector<ADDR> &addresses = inst.addresses;
+	WALKS &walks = inst.walks;
+	vector<vector<int> > &stopAdjList = inst.stopAdjList;
+	vector<vector<double> > &stopAdjTime = inst.stopAdjTime;
+	COVERSETS &coverSets = inst.coverSets;
+	BitMatrix &coverBits = inst.coverBits;
+	const double maxWalkDist = inst.maxWalkDist;
+	const string &distUnits = inst.distUnits;
+	int i, j, p, u, n = stops.size(), m = addresses.size();
+	vector<int> row, lastPair(n, -1);
+	vector<double> key(max(n, m));
+	vector<vector<int> > pairsOfAddr(m);
+	for (p = 0; p < walkPairs.size(); p++) {
+		if (walkPairs[p].addr < 0 || walkPairs[p].addr >= m || walkPairs[p].stop < 0 || walkPairs[p].stop >= n) {
+			cout << "Error. Walk " << p << " refers to an invalid address or stop. Invalid input file\n";
+			exit(1);
 		}
-		if (addrAdjList[i].size() == 0) {
+		pairsOfAddr[walkPairs[p].addr].push_back(p);
+	}
+	//Build the walks structure one address at a time
+	walks.start.assign(1, 0);
+	walks.stop.clear();
+	walks.time.clear();
+	walks.dist.clear();
+	for (i = 0; i < m; i++) {
+		row.clear();
+		for (j = 0; j < pairsOfAddr[i].size(); j++) {
+			p = pairsOfAddr[i][j];
+			u = walkPairs[p].stop;
+			if (lastPair[u] == -1) row.push_back(u);
+			lastPair[u] = p;
+		}
+		//Keep only the adjacent stops, first in order of index, and then in ascending order of walk time
+		sort(row.begin(), row.end());
+		j = 0;
+		for (p = 0; p < row.size(); p++) {
+			u = row[p];
+			if (u != 0 && walkPairs[lastPair[u]].dist <= maxWalkDist) row[j++] = u;
+			else lastPair[u] = -1;
+		}
+		row.resize(j);
+		for (j = 0; j < row.size(); j++) key[row[j]] = walkPairs[lastPair[row[j]]].time;
+		qSortByKey(row, 0, row.size(), key);
+		for (j = 0; j < row.size(); j++) {
+			u = row[j];
+			walks.stop.push_back(u);
+			walks.time.push_back(walkPairs[lastPair[u]].time);
+			walks.dist.push_back(walkPairs[lastPair[u]].dist);
+			lastPair[u] = -1;
+		}
+		walks.start.push_back(walks.stop.size());
+		if (row.size() == 0) {
 			cout << "Error. Address " << i << "(" << addresses[i].label << ") has no bus stop within " << maxWalkDist << " " << distUnits << ". Invalid input file\n";
 			exit(1);
 		}
-		if (addrAdjList[i].size() == 1) {
+		if (row.size() == 1) {
 			//Address adjacent to just one adjacent bus stop. So this stop is required in a solution
-			stops[addrAdjList[i][0]].required = true;
+			stops[row[0]].required = true;
 		}
 	}
-	//Adj list specifying the addresses adjacent to each stop
-	stopAdjList.resize(stops.size(), vector<int>());
-	for (i = 1; i < stops.size(); i++) {
-		for (j = 0; j < addresses.size(); j++) {
-			if (wDist[j][i] <= maxWalkDist) stopAdjList[i].push_back(j);
+	//Adj list specifying the addresses adjacent to each stop (in ascending order of address first)
+	stopAdjList.clear();
+	stopAdjList.resize(n, vector<int>());
+	stopAdjTime.clear();
+	stopAdjTime.resize(n, vector<double>());
+	for (i = 0; i < m; i++) {
+		for (p = walks.start[i]; p < walks.start[i + 1]; p++) {
+			stopAdjList[walks.stop[p]].push_back(i);
+			stopAdjTime[walks.stop[p]].push_back(walks.time[p]);
 		}
+	}
+	//The lists are currently in ascending order of address, which is the order the set covering procedures need
+	coverSets.start.assign(1, 0);
+	coverSets.addr.clear();
+	for (i = 0; i < n; i++) {
+		coverSets.addr.insert(coverSets.addr.end(), stopAdjList[i].begin(), stopAdjList[i].end());
+		coverSets.start.push_back(coverSets.addr.size());
+	}
+	coverBits.assign(n, m);
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < stopAdjList[i].size(); j++) coverBits.set(i, stopAdjList[i][j], true);
+	}
+	for (i = 1; i < n; i++) {
 		if (stopAdjList[i].size() == 0) {
 			cout << "Error. Stop " << i << "(" << stops[i].label << ") is isolated (more than " << maxWalkDist << " " << distUnits <<" from any address). Invalid input file.\n";
 			//If the following exit statement is removed, the program will work just fine. It is there to let me know if the problem instance has not been generated correctly
 			exit(1);
 		}
+		//and then in ascending order of walk time
+		for (j = 0; j < stopAdjList[i].size(); j++) key[stopAdjList[i][j]] = stopAdjTime[i][j];
+		qSortByKey(stopAdjList[i], 0, stopAdjList[i].size(), key);
+		for (j = 0; j < stopAdjList[i].size(); j++) stopAdjTime[i][j] = key[stopAdjList[i][j]];
+	}
+}
+
+void reduceInstance(Instance &inst) {
+	//Removes dominated stops from the instance. Stop u is dominated by stop v if every address adjacent to u is also
+	//adjacent to v, with a walk time to v no longer than to u. (If the two are identical, the higher numbered one is
+	//dominated.) Since u can then always be swapped for v without lengthening anyone's walk, it is taken out of the
+	//adjacencies of its addresses and left isolated, so it is never used. Dominance is transitive, so one pass finds every
+	//dominated stop. Any address left with a single adjacent stop then makes that stop compulsory. Note that u may be
+	//better placed than v for the bus routes, which is why this is optional (-R)
+	vector<STOP> &stops = inst.stops;
+	WALKS &walks = inst.walks;
+	vector<vector<int> > &stopAdjList = inst.stopAdjList;
+	COVERSETS &coverSets = inst.coverSets;
+	int a, first, p, q, u, v, n = stops.size(), m = inst.addresses.size(), numRemoved = 0, numRequired = 0, numForced = 0;
+	bool identical;
+	vector<char> removed(n, 0);
+	for (u = 1; u < n; u++) {
+		if (stops[u].required || coverSets.size(u) == 0) continue;
+		//Any stop dominating u must be adjacent to u's first address
+		first = coverSets.addr[coverSets.start[u]];
+		for (p = walks.start[first]; p < walks.start[first + 1]; p++) {
+			v = walks.stop[p];
+			if (v == u || removed[v] || coverSets.size(v) < coverSets.size(u)) continue;
+			if (!includes(coverSets.begin(v), coverSets.end(v), coverSets.begin(u), coverSets.end(u))) continue;
+			identical = coverSets.size(v) == coverSets.size(u);
+			for (q = coverSets.start[u]; q < coverSets.start[u + 1]; q++) {
+				a = coverSets.addr[q];
+				if (walks.timeTo(a, v) > walks.timeTo(a, u)) break;
+				if (walks.timeTo(a, v) < walks.timeTo(a, u)) identical = false;
+			}
+			if (q < coverSets.start[u + 1] || (identical && v > u)) continue;
+			removed[u] = 1;
+			numRemoved++;
+			break;
+		}
+	}
+	if (numRemoved == 0) {
+		cout << "Instance reduction: no dominated stops found\n";
+		return;
+	}
+	//Take the removed stops out of the walks, keeping the order of the rest
+	q = 0;
+	for (a = 0; a < m; a++) {
+		p = walks.start[a];
+		walks.start[a] = q;
+		for (; p < walks.start[a + 1]; p++) {
+			if (removed[walks.stop[p]]) continue;
+			walks.stop[q] = walks.stop[p];
+			walks.time[q] = walks.time[p];
+			walks.dist[q] = walks.dist[p];
+			q++;
+		}
+	}
+	walks.start[m] = q;
+	walks.stop.resize(q);
+	walks.time.resize(q);
+	walks.dist.resize(q);
+	//and out of the stop-based lists
+	for (u = 1; u < n; u++) {
+		if (!removed[u]) continue;
+		stopAdjList[u].clear();
+		inst.stopAdjTime[u].clear();
+		inst.coverBits.clearRow(u);
+	}
+	q = 0;
+	for (u = 0; u < n; u++) {
+		p = coverSets.start[u];
+		coverSets.start[u] = q;
+		if (!removed[u]) for (; p < coverSets.start[u + 1]; p++) coverSets.addr[q++] = coverSets.addr[p];
+	}
+	coverSets.start[n] = q;
+	coverSets.addr.resize(q);
+	//Propagate the forced stops
+	for (u = 1; u < n; u++) if (stops[u].required) numRequired++;
+	for (a = 0; a < m; a++) {
+		if (walks.numAdj(a) == 1 && !stops[walks.adjStop(a, 0)].required) {
+			stops[walks.adjStop(a, 0)].required = true;
+			numForced++;
+		}
+	}
+	cout << "Instance reduction: " << numRemoved << " of " << n - 1 << " stops removed as dominated. " << numForced << " more stops are now compulsory (" << numRequired + numForced << " in total)\n";
+}
+
+//-------------- Reading problem files in the binary (.busbin) format --------------------------------
+struct MAPPEDFILE {
+	const char *data;
+	size_t size;
+	bool isMapped;			//True if data is a memory mapping, false if it is a heap buffer
+};
+
+//The mapping of a binary input file whose matrices are being used in place (kept until the program ends)
+MAPPEDFILE mappedInput = { NULL, 0, false };
+
+bool mapFile(const string &fileName, MAPPEDFILE &F) {
+	//Makes the contents of a file available in memory (read only). Uses mmap where available.
+	F.data = NULL;
+	F.size = 0;
+	F.isMapped = false;
+#ifdef _WIN32
+	ifstream inStream(fileName, ios::binary | ios::ate);
+	if (inStream.fail()) return false;
+	F.size = inStream.tellg();
+	char *buf = new char[F.size];
+	inStream.seekg(0);
+	inStream.read(buf, F.size);
+	if (inStream.fail()) { delete[] buf; return false; }
+	F.data = buf;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) { close(fd); return false; }
+	F.size = st.st_size;
+	void *p = mmap(NULL, F.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) return false;
+	F.data = (const char *)p;
+	F.isMapped = true;
+#endif
+	return true;
+}
+
+void unmapFile(MAPPEDFILE &F) {
+	if (F.data == NULL) return;
+#ifdef _WIN32
+	delete[] F.data;
+#else
+	if (F.isMapped) munmap((void *)F.data, F.size);
+#endif
+	F.data = NULL;
+	F.size = 0;
+}
+
+bool isBinaryInput(const string &infile) {
+	//Returns true if infile exists and starts with the .busbin magic string
+	char magic[sizeof(BUSBIN_MAGIC)];
+	ifstream inStream(infile, ios::binary);
+	if (inStream.fail()) return false;
+	inStream.read(magic, sizeof(magic));
+	if (inStream.gcount() != sizeof(magic)) return false;
+	return memcmp(magic, BUSBIN_MAGIC, sizeof(magic)) == 0;
+}
+
+bool isOlderFile(const string &file1, const string &file2) {
+	//Returns true if both files exist and file1 was last modified before file2
+	struct stat s1, s2;
+	if (stat(file1.c_str(), &s1) != 0 || stat(file2.c_str(), &s2) != 0) return false;
+	return s1.st_mtime < s2.st_mtime;
+}
+
+void readBinaryInput(Instance &inst, string &infile) {
+	//Reads in a problem file in the binary .busbin format (see busbin.h)
+	vector<STOP> &stops = inst.stops;
+	vector<ADDR> &addresses = inst.addresses;
+	FlatMatrix<double> &dDist = inst.dDist;
+	FlatMatrix<double> &dTime = inst.dTime;
+	int &totalPassengers = inst.totalPassengers;
+	int i, numStops, numAddresses, numWalks;
+	MAPPEDFILE F;
+	if (!mapFile(infile, F)) { cout << "ERROR OPENING INPUT FILE"; exit(1); }
+
+	//Check the header before trusting any of the offsets in it
+	const BUSBINHEADER *H = (const BUSBINHEADER *)F.data;
+	if (F.size < sizeof(BUSBINHEADER) || memcmp(H->magic, BUSBIN_MAGIC, sizeof(BUSBIN_MAGIC)) != 0) {
+		cout << "Error. " << infile << " is not a valid .busbin file\n";
+		exit(1);
 	}
-	//In each adjacencey list we now sort the items so that, on each row i, the stops (addresses) are in ascending order of distance
-	for (i = 0; i < addresses.size(); i++) {
-		qSortStopsByDist(addrAdjList[i], 0, addrAdjList[i].size(), i);
+	if (H->version != BUSBIN_VERSION || H->endianTag != BUSBIN_ENDIAN_TAG) {
+		cout << "Error. " << infile << " was written by an incompatible version of the converter (or on a machine with different byte order)\n";
+		exit(1);
 	}
-	for (i = 1; i < stops.size(); i++) {
-		qSortAddressesByDist(stopAdjList[i], 0, stopAdjList[i].size(), i);
+	numStops = H->numStops;
+	numAddresses = H->numAddresses;
+	numWalks = H->numWalks;
+	if (H->fileSize != F.size || H->rowStride < H->numStops
+		|| H->offStops + numStops * sizeof(BUSBINSTOP) > F.size
+		|| H->offAddresses + numAddresses * sizeof(BUSBINADDR) > F.size
+		|| H->offDDist + uint64_t(numStops) * H->rowStride * sizeof(double) > F.size
+		|| H->offDTime + uint64_t(numStops) * H->rowStride * sizeof(double) > F.size
+		|| H->offWalks + numWalks * sizeof(BUSBINWALK) > F.size
+		|| H->offLabels + H->labelsSize > F.size) {
+		cout << "Error. " << infile << " is truncated or corrupt\n";
+		exit(1);
 	}
+	if (H->distUnits == 'K') inst.distUnits = "kms";
+	else inst.distUnits = "miles";
+	//These are rounded to float precision, as readInput() does (it reads them with stof), so that the same walks are
+	//within the maximum walking distance whichever format is read
+	inst.minEligibilityDist = float(H->minEligibilityDist);
+	inst.maxWalkDist = float(H->maxWalkDist);
+
+	cout << "Processing " << infile << " (binary)\n";
+
+	const BUSBINSTOP *binStops = (const BUSBINSTOP *)(F.data + H->offStops);
+	const BUSBINADDR *binAddrs = (const BUSBINADDR *)(F.data + H->offAddresses);
+	const double *binDDist = (const double *)(F.data + H->offDDist);
+	const double *binDTime = (const double *)(F.data + H->offDTime);
+	const BUSBINWALK *binWalks = (const BUSBINWALK *)(F.data + H->offWalks);
+	const char *labels = F.data + H->offLabels;
+
+	//Stops and addresses
+	totalPassengers = 0;
+	stops.resize(numStops);
+	addresses.resize(numAddresses);
+	for (i = 0; i < numStops; i++) {
+		stops[i].x = binStops[i].x;
+		stops[i].y = binStops[i].y;
+		stops[i].label.assign(labels + binStops[i].labelOff, binStops[i].labelLen);
+		stops[i].required = false;
+	}
+	for (i = 0; i < numAddresses; i++) {
+		addresses[i].x = binAddrs[i].x;
+		addresses[i].y = binAddrs[i].y;
+		addresses[i].numPass = binAddrs[i].numPass;
+		addresses[i].label.assign(labels + binAddrs[i].labelOff, binAddrs[i].labelLen);
+		totalPassengers += addresses[i].numPass;
+	}
+
+	//The stop-to-stop matrices have the same layout as a FlatMatrix, so they are used in place when the file
+	//is memory mapped (and suitably aligned). The mapping is then kept for the rest of the run.
+	bool inPlace = F.isMapped && H->rowStride == FlatMatrix<double>::strideFor(numStops)
+		&& (uintptr_t(binDDist) % MATRIX_ALIGN) == 0 && (uintptr_t(binDTime) % MATRIX_ALIGN) == 0;
+	if (inPlace) {
+		dDist.adopt(binDDist, numStops, numStops, H->rowStride);
+		dTime.adopt(binDTime, numStops, numStops, H->rowStride);
+	}
+	else {
+		dDist.resize(numStops, numStops, 0.0);
+		dTime.resize(numStops, numStops, 0.0);
+		for (i = 0; i < numStops; i++) {
+			memcpy(dDist.row(i), binDDist + size_t(i) * H->rowStride, numStops * sizeof(double));
+			memcpy(dTime.row(i), binDTime + size_t(i) * H->rowStride, numStops * sizeof(double));
+		}
+	}
+
+	//And the walking pairs
+	vector<WALKPAIR> walkPairs(numWalks);
+	for (i = 0; i < numWalks; i++) {
+		walkPairs[i].addr = binWalks[i].addr;
+		walkPairs[i].stop = binWalks[i].stop;
+		walkPairs[i].dist = binWalks[i].dist;
+		walkPairs[i].time = binWalks[i].time;
+	}
+	if (inPlace) mappedInput = F;
+	else unmapFile(F);
+
+	buildAdjacencies(inst, walkPairs);
 }
 
@@ -3,7 +3,10 @@
 
 #include "main.h"
 
-void readInput(string &infile);
+void readInput(Instance &inst, string &infile);
+bool isBinaryInput(const string &infile);
+bool isOlderFile(const string &file1, const string &file2);
+void readBinaryInput(Instance &inst, string &infile);
+void reduceInstance(Instance &inst);
 
 #endif //INPUT_H
-
@@ -0,0 +1,131 @@
+#include "insertscan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+using namespace std;
+
+bool simdAvailable() {
+	//True if the AVX2 kernels can be used on this CPU
+#ifdef HAVE_X86_SIMD
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+#else
+	return false;
+#endif
+}
+
+//-------------- Inserting a section (a...b) into route R ----------------------------------------------------
+inline
+void scoreSectionPos(const FlatMatrix<double> &dTime, RaggedArray<int>::ConstRow R, double routeLen, int a, int b,
+	double innerX, double innerXF, double dwellX, double *len, double *lenF, int j) {
+	//Length of route R after inserting the section before R[j], forwards (len) and flipped (lenF). The expressions
+	//are those of evaluateInsert()
+	int n = R.size();
+	if (j == 0) {
+		len[j] = routeLen + dTime(b, R[j]) + innerX + dwellX;
+		lenF[j] = routeLen + dTime(a, R[j]) + innerXF + dwellX;
+	}
+	else if (j == n) {
+		len[j] = routeLen - dTime(R[j - 1], 0) + dTime(R[j - 1], a) + dTime(b, 0) + innerX + dwellX;
+		lenF[j] = routeLen - dTime(R[j - 1], 0) + dTime(R[j - 1], b) + dTime(a, 0) + innerXF + dwellX;
+	}
+	else {
+		len[j] = routeLen - dTime(R[j - 1], R[j]) + dTime(R[j - 1], a) + dTime(b, R[j]) + innerX + dwellX;
+		lenF[j] = routeLen - dTime(R[j - 1], R[j]) + dTime(R[j - 1], b) + dTime(a, R[j]) + innerXF + dwellX;
+	}
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+inline __m256d gather4(const double *D, __m128i idx) {
+	//Loads D[idx[0]],...,D[idx[3]]. The masked form is used because the plain one upsets -Wmaybe-uninitialized in GCC 12
+	return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), D, idx, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+
+__attribute__((target("avx2")))
+int scanSectionInsertAVX2(const FlatMatrix<double> &dTime, RaggedArray<int>::ConstRow R, double routeLen, int a, int b,
+	double innerX, double innerXF, double dwellX, double *len, double *lenF) {
+	//Scores the interior positions j = 1,...,n-1 four at a time. Each lane gathers its five distances from the
+	//flat distance matrix. Returns the first position not yet scored
+	const double *D = dTime.row(0);
+	int j, n = R.size();
+	const __m128i stride = _mm_set1_epi32(dTime.rowStride());
+	const __m128i colA = _mm_set1_epi32(a), colB = _mm_set1_epi32(b);
+	const __m128i rowA = _mm_set1_epi32(a * dTime.rowStride()), rowB = _mm_set1_epi32(b * dTime.rowStride());
+	const __m256d rl = _mm256_set1_pd(routeLen), inX = _mm256_set1_pd(innerX), inXF = _mm256_set1_pd(innerXF), dw = _mm256_set1_pd(dwellX);
+	for (j = 1; j + 4 <= n; j += 4) {
+		__m128i prev = _mm_loadu_si128((const __m128i *)&R[j - 1]);
+		__m128i next = _mm_loadu_si128((const __m128i *)&R[j]);
+		__m128i prevRow = _mm_mullo_epi32(prev, stride);
+		__m256d dPN = gather4(D, _mm_add_epi32(prevRow, next));
+		__m256d dPA = gather4(D, _mm_add_epi32(prevRow, colA));
+		__m256d dPB = gather4(D, _mm_add_epi32(prevRow, colB));
+		__m256d dBN = gather4(D, _mm_add_epi32(rowB, next));
+		__m256d dAN = gather4(D, _mm_add_epi32(rowA, next));
+		__m256d base = _mm256_sub_pd(rl, dPN);
+		_mm256_storeu_pd(len + j, _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(base, dPA), dBN), inX), dw));
+		_mm256_storeu_pd(lenF + j, _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(base, dPB), dAN), inXF), dw));
+	}
+	return j;
+}
+#endif
+
+void scanSectionInsert(const FlatMatrix<double> &dTime, RaggedArray<int>::ConstRow R, double routeLen, int a, int b,
+	double innerX, double innerXF, double dwellX, double *len, double *lenF, bool useSIMD) {
+	//Fills len[j] and lenF[j] (j = 0,...,R.size()) with the length of nonempty route R after inserting the section
+	//with first stop a and last stop b before R[j], forwards and flipped respectively
+	int j = 1, n = R.size();
+	scoreSectionPos(dTime, R, routeLen, a, b, innerX, innerXF, dwellX, len, lenF, 0);
+#ifdef HAVE_X86_SIMD
+	if (useSIMD && simdAvailable()) j = scanSectionInsertAVX2(dTime, R, routeLen, a, b, innerX, innerXF, dwellX, len, lenF);
+#endif
+	for (; j <= n; j++) scoreSectionPos(dTime, R, routeLen, a, b, innerX, innerXF, dwellX, len, lenF, j);
+}
+
+//-------------- Inserting a single stop v into route R ------------------------------------------------------
+inline
+double scoreStopPos(const FlatMatrix<double> &dTime, RaggedArray<int>::ConstRow R, int v, int j) {
+	//Extra travel time from inserting v before R[j]
+	int n = R.size();
+	if (j == 0) return dTime(v, R[j]);
+	else if (j == n) return dTime(R[j - 1], v) + dTime(v, 0) - dTime(R[j - 1], 0);
+	else return dTime(R[j - 1], v) + dTime(v, R[j]) - dTime(R[j - 1], R[j]);
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2")))
+int scanStopInsertAVX2(const FlatMatrix<double> &dTime, RaggedArray<int>::ConstRow R, int v, double *cost) {
+	//As scanSectionInsertAVX2(), for the interior positions of a single stop
+	const double *D = dTime.row(0);
+	int j, n = R.size();
+	const __m128i stride = _mm_set1_epi32(dTime.rowStride());
+	const __m128i colV = _mm_set1_epi32(v), rowV = _mm_set1_epi32(v * dTime.rowStride());
+	for (j = 1; j + 4 <= n; j += 4) {
+		__m128i prev = _mm_loadu_si128((const __m128i *)&R[j - 1]);
+		__m128i next = _mm_loadu_si128((const __m128i *)&R[j]);
+		__m128i prevRow = _mm_mullo_epi32(prev, stride);
+		__m256d dPV = gather4(D, _mm_add_epi32(prevRow, colV));
+		__m256d dVN = gather4(D, _mm_add_epi32(rowV, next));
+		__m256d dPN = gather4(D, _mm_add_epi32(prevRow, next));
+		_mm256_storeu_pd(cost + j, _mm256_sub_pd(_mm256_add_pd(dPV, dVN), dPN));
+	}
+	return j;
+}
+#endif
+
+int bestStopInsertPos(const FlatMatrix<double> &dTime, RaggedArray<int>::ConstRow R, int v, vector<double> &cost, bool useSIMD) {
+	//Returns the position j at which inserting stop v into nonempty route R adds least travel time (the first such
+	//position if there are ties). cost is used as working space
+	int j = 1, best = 0, n = R.size();
+	cost.resize(n + 1);
+	cost[0] = scoreStopPos(dTime, R, v, 0);
+#ifdef HAVE_X86_SIMD
+	if (useSIMD && simdAvailable()) j = scanStopInsertAVX2(dTime, R, v, cost.data());
+#endif
+	for (; j <= n; j++) cost[j] = scoreStopPos(dTime, R, v, j);
+	for (j = 1; j <= n; j++) if (cost[j] < cost[best]) best = j;
+	return best;
+}
@@ -0,0 +1,16 @@
+#ifndef INSERTSCAN_H
+#define INSERTSCAN_H
+
+#include <vector>
+#include "matrix.h"
+#include "ragged.h"
+
+//Kernels that score every insertion position of a route in one pass. Position j means "before R[j]" (j = R.size()
+//means at the end of the route, just before the depot). When useSIMD is true and the CPU supports it, an AVX2 version
+//is used; otherwise a scalar loop. Both do the same floating point operations in the same order, so give identical results
+bool simdAvailable();
+void scanSectionInsert(const FlatMatrix<double> &dTime, RaggedArray<int>::ConstRow R, double routeLen, int a, int b,
+	double innerX, double innerXF, double dwellX, double *len, double *lenF, bool useSIMD);
+int bestStopInsertPos(const FlatMatrix<double> &dTime, RaggedArray<int>::ConstRow R, int v, std::vector<double> &cost, bool useSIMD);
+
+#endif //INSERTSCAN_H
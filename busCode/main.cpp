@@ -1,41 +1,19 @@
 #include "main.h"
 
-//Global variables
-vector<STOP> stops;
-vector<ADDR> addresses;
-vector<bool> isOutlier;
-vector<vector<double> > dDist;
-vector<vector<double> > dTime;
-vector<vector<double> > wDist;
-vector<vector<double> > wTime;
-vector<vector<int> > stopAdjList; //Gives a list of addresses adjacent to each stop
-vector<vector<int> > addrAdjList; //Gives a list of stops adjacent to each address
-vector<vector<bool> > addrStopAdj;
-int totalPassengers, maxBusCapacity, kInit, timePerK;
-string distUnits;
-double maxWalkDist;
-double minEligibilityDist;
-double dwellPerPassenger;
-double dwellPerStop;
-double excessWeight;
-double maxJourneyTime;
-double discreteLevel;
-int verbosity;
-bool useMinCoverings;
-
-void printSln(SOL &S) {
+void printSln(const SolverContext &ctx, SOL &S) {
 	//Writes details of a particular solution to the screen
+	const Instance &inst = *ctx.inst;
 	int i, j, k = S.items.size();
 	bool containsOutlier = false;
 	cout << "****************SOLUTION******************************\n";
 	cout << "Number of buses = " << S.items.size() <<"\n"
-		<< "Average walk time per person = " << (S.costWalk / double(totalPassengers)) / 60.0 << " mins.\n"		
+		<< "Average walk time per person = " << (S.costWalk / double(inst.totalPassengers)) / 60.0 << " mins.\n"		
 		<< "Average route length = " << (sumDouble(S.routeLen) / double(k)) / 60.0 << " mins.\n"
 		<< "The bus stops visited in each route, in order, are as follows:\n";
 	for (i = 0; i < k; i++) {
 		cout << "Route" << setw(3) << i << " (" << setw(3) << int(ceil(S.routeLen[i] / 60.0)) << " mins) = ( ";
 		for (j = 0; j < S.items[i].size(); j++) {
-			if (isOutlier[S.items[i][j]]) {
+			if (ctx.isOutlier[S.items[i][j]]) {
 				cout << S.items[i][j] << "* ";
 				containsOutlier = true;
 			}
@@ -45,70 +23,303 @@ void printSln(SOL &S) {
 	}
 	if (containsOutlier) cout << "Outlier bus stops (compulsory bus stops more than m_t mins from the school) are marked with an *s.\n";
 	cout << "The address -> bus stop assignments, in order, are as follows:\n{ ";
-	for (i = 0; i < addresses.size(); i++) {
+	for (i = 0; i < inst.addresses.size(); i++) {
 		cout << "(" << i << "," << S.assignedTo[i] << ") ";
 	}
 	cout << "}\n";
 	cout << "******************************************************\n\n";
 }
 
-SOL ILS(int k, bool &foundFeas) {
-	//The ILS algorithm for producing a solution using k buses.
-	bool feasible = false;
-	foundFeas = false;
+struct ILSSTATS {
+	//Statistics on a single ILS trajectory (there is one trajectory per thread)
+	unsigned int seed;			//Seed of the trajectory's random number generator
+	int heuristic;				//Heuristic passed to makeInitSol() to form the trajectory's initial solution
+	int its;					//Number of calls to the local search
+	int numFeasible;			//Number of these that gave a feasible solution
+	int numIncumbent;			//Number of times the trajectory improved the shared incumbent
+	double bestCost;			//Cost of the best solution found by the trajectory
+	bool foundFeas;				//True if the trajectory found a feasible solution
+};
+
+struct INCUMBENT {
+	//The best solution found so far over all ILS trajectories for a particular k. Trajectories offer their improved
+	//solutions to it, so access must be made while holding lock
+	mutex lock;
+	SOL S;
+	bool hasSol;
+	bool foundFeas;
+	int owner;					//Trajectory that produced S
+	atomic<bool> *feasSignal;	//If not NULL, this is set as soon as a feasible solution is found
+};
+
+struct ILSBUDGET {
+	//The amount of search each ILS trajectory is given
+	int maxIts;					//Number of iterations (used when timePerK is negative)
+	bool useWallClock;			//If true, the time limit is measured in wall-clock time (needed with >1 thread since clock() adds up all threads)
+	clock_t endClock;
+	chrono::steady_clock::time_point endWall;
+	const atomic<bool> *cancel;	//If not NULL, the trajectories stop as soon as this is set
+};
+
+bool withinBudget(const ILSBUDGET &B, int its) {
+	//Returns true if a trajectory that has done "its" iterations should carry on
+	if (B.cancel != NULL && *B.cancel) return false;
+	if (its <= B.maxIts) return true;
+	if (B.useWallClock) return chrono::steady_clock::now() < B.endWall;
+	else return clock() < B.endClock;
+}
+
+void offerToIncumbent(INCUMBENT &I, SOL &S, bool feasible, int owner, ILSSTATS &stats) {
+	//Replaces the incumbent with S if S is better. As in the ILS itself, a feasible solution is always better than
+	//an infeasible one. Ties in cost are broken by the trajectory number so that the outcome does not depend on timings
+	lock_guard<mutex> guard(I.lock);
+	bool better;
+	if (!I.hasSol) better = true;
+	else if (feasible != I.foundFeas) better = feasible;
+	else if (S.cost != I.S.cost) better = S.cost < I.S.cost;
+	else better = owner < I.owner;
+	if (better) {
+		I.S = S;
+		I.hasSol = true;
+		I.foundFeas = feasible;
+		I.owner = owner;
+		stats.numIncumbent++;
+		if (feasible && I.feasSignal != NULL) *I.feasSignal = true;
+	}
+}
+
+void runILS(SolverContext &ctx, int k, int heuristic, const ILSBUDGET &B, INCUMBENT &I, int owner, ILSSTATS &stats) {
+	//A single ILS trajectory using k buses. The best solution found is offered to the incumbent I
+	bool feasible = false, foundFeas = false, printTable = ctx.verbosity >= 2 && ctx.numThreads <= 1;
 	int i = 1;
 	SOL S, bestS;
 	double feasRatio;
-	clock_t endTime;
-	int numMoves, stopsDeleted, maxIts;
-	//Decide if we're running the procedure to a time limit or iteration limit
-	if (timePerK >= 0) {
-		endTime = clock() + timePerK * CLOCKS_PER_SEC;
-		maxIts = 0;
-	}
-	else {
-		endTime = 0;
-		maxIts = timePerK * -1;
-	}
+	int numMoves, stopsDeleted;
+	stats.heuristic = heuristic;
+	stats.its = 1;
+	stats.numFeasible = 0;
+	stats.numIncumbent = 0;
 	//Produce an inital solution and move to a minimum
-	makeInitSol(S, k, 1);
-	feasible = localSearch(S, feasRatio, numMoves);
+	makeInitSol(ctx, S, k, heuristic);
+	feasible = localSearch(ctx, S, feasRatio, numMoves);
 	if (feasible && !foundFeas) {
 		//Feasibility has been found for the first time,
 		foundFeas = true;
 	}
+	if (feasible) stats.numFeasible++;
 	bestS = S;
-	if (verbosity >= 2) {
+	offerToIncumbent(I, bestS, foundFeas, owner, stats);
+	if (printTable) {
 		cout << "\n  k      it        Cost  #Feas #Empty       #Stops    StopsDel  MovesToMin    BestCost\n";
 		cout << "-------------------------------------------------------------------------------------------------\n";
 		cout << setw(3) << k << setw(8) << i << setw(12) << S.cost << setw(7) << S.numFeasibleRoutes << setw(7) << S.numEmptyRoutes << setw(10) << S.solSize << "/" << S.numUsedStops << setw(12) << "-" << setw(12) << numMoves << setw(12) << bestS.cost << "\n";
 	}
-	while(clock() < endTime || i <= maxIts) {
+	while(withinBudget(B, i)) {
 		//Peturb the solution and move to the minimum
-		stopsDeleted = makeNewCovering(S);
-		feasible = localSearch(S, feasRatio, numMoves);
+		stopsDeleted = makeNewCovering(ctx, S);
+		feasible = localSearch(ctx, S, feasRatio, numMoves);
 		i++;
+		if (feasible) stats.numFeasible++;
 		if (feasible && !foundFeas) {
 			//Feasibility has been found for the first time, so record the solution
 			foundFeas = true;
 			bestS = S;
+			offerToIncumbent(I, bestS, foundFeas, owner, stats);
 		}
 		else if (feasible && S.cost < bestS.cost) {
 			//A new feasible solution has been found with an even better cost, so record it 
 			bestS = S;
+			offerToIncumbent(I, bestS, foundFeas, owner, stats);
 		}
 		else if (!feasible && !foundFeas && S.cost < bestS.cost) {
 			//Feasibility has not yet been found, but we have found a better infeasible solution so record it
 			bestS = S;
+			offerToIncumbent(I, bestS, foundFeas, owner, stats);
 		}
 		//Note, we do not accept a new infeasible solution that has a better cost than a previously oberved feasible solution
-		if (verbosity >= 2) {
+		if (printTable) {
 			cout << setw(3) << k << setw(8) << i << setw(12) << S.cost << setw(7) << S.numFeasibleRoutes << setw(7) << S.numEmptyRoutes << setw(10) << S.solSize << "/" << S.numUsedStops << setw(12) << stopsDeleted << setw(12) << numMoves << setw(12) << bestS.cost << "\n";
 		}
 	}
-	return bestS;
+	stats.its = i;
+	stats.bestCost = bestS.cost;
+	stats.foundFeas = foundFeas;
 }
 
+SOL ILS(SolverContext &ctx, int k, bool &foundFeas, const atomic<bool> *cancel = NULL, atomic<bool> *feasSignal = NULL, bool concurrent = false) {
+	//The ILS algorithm for producing a solution using k buses. With more than one thread, ctx.numThreads independent
+	//trajectories are run in parallel, each with its own seed and initial solution heuristic, and the best solution
+	//over all of them is returned. If given, cancel stops the search early, and feasSignal is set as soon as a
+	//feasible solution is found. If the local search itself is running in parallel (-P), a single trajectory is run.
+	//Concurrent should be true if other threads are running at the same time as this call (see concurrentKSearch())
+	int t, numThreads = ctx.lsPool != NULL ? 1 : max(ctx.numThreads, 1);
+	INCUMBENT I;
+	ILSBUDGET B;
+	vector<ILSSTATS> stats(numThreads);
+	I.hasSol = false;
+	I.foundFeas = false;
+	I.owner = -1;
+	I.feasSignal = feasSignal;
+	B.cancel = cancel;
+	//Decide if we're running the procedure to a time limit or iteration limit
+	//(clock() adds up the time of all the threads in the process, so is only used when nothing else is running)
+	B.useWallClock = numThreads > 1 || ctx.lsPool != NULL || concurrent;
+	if (ctx.timePerK >= 0) {
+		B.endClock = clock() + ctx.timePerK * CLOCKS_PER_SEC;
+		B.endWall = chrono::steady_clock::now() + chrono::seconds(ctx.timePerK);
+		B.maxIts = 0;
+	}
+	else {
+		B.endClock = 0;
+		B.endWall = chrono::steady_clock::now();
+		B.maxIts = ctx.timePerK * -1;
+	}
+	if (numThreads == 1) {
+		//Run a single trajectory in this thread, using the caller's context
+		stats[0].seed = 0;
+		runILS(ctx, k, 1, B, I, 0, stats[0]);
+	}
+	else {
+		//Each trajectory gets its own copy of the context (and so its own scratch buffers and random number generator).
+		//The seeds are drawn from the caller's generator so a run is reproducible for a given -r value. Trajectories
+		//cycle through the three initial solution heuristics of makeInitSol()
+		vector<SolverContext> workerCtx(numThreads, ctx);
+		vector<thread> workers;
+		for (t = 0; t < numThreads; t++) {
+			stats[t].seed = ctx.rng();
+			workerCtx[t].rng.seed(stats[t].seed);
+			workerCtx[t].pool = NULL;
+			workerCtx[t].lsPool = NULL;
+			clearEvalCounts(workerCtx[t]);
+		}
+		for (t = 0; t < numThreads; t++) {
+			workers.push_back(thread(runILS, ref(workerCtx[t]), k, t % 3 + 1, cref(B), ref(I), t, ref(stats[t])));
+		}
+		for (t = 0; t < numThreads; t++) workers[t].join();
+		for (t = 0; t < numThreads; t++) addEvalCounts(ctx, workerCtx[t]);
+		if (ctx.verbosity >= 1) {
+			cout << "\n  k  Thread        Seed  Heur       its   #FeasIts  #Incumbent      BestCost\n";
+			cout << "------------------------------------------------------------------------------\n";
+			for (t = 0; t < numThreads; t++) {
+				cout << setw(3) << k << setw(8) << t << setw(12) << stats[t].seed << setw(6) << stats[t].heuristic << setw(10) << stats[t].its << setw(11) << stats[t].numFeasible << setw(12) << stats[t].numIncumbent << setw(14) << stats[t].bestCost << (stats[t].foundFeas ? "" : " (infeasible)") << (t == I.owner ? " *" : "") << "\n";
+			}
+		}
+	}
+	foundFeas = I.foundFeas;
+	return I.S;
+}
+
+
+struct KSLOT {
+	//A run of the ILS for one value of k in a concurrent k-search
+	int k;
+	SolverContext ctx;
+	SOL S;
+	bool foundFeas;
+	atomic<bool> cancel;		//Set by the coordinator to stop the run
+	atomic<bool> feasible;		//Set by the run as soon as it has a feasible solution
+	atomic<bool> done;
+};
+
+void runKSlot(KSLOT &slot) {
+	slot.S = ILS(slot.ctx, slot.k, slot.foundFeas, &slot.cancel, &slot.feasible, true);
+	slot.done = true;
+}
+
+SOL concurrentKSearch(SolverContext &ctx, int &k, int kWindow, bool &foundFeas) {
+	//Stage 1 of the algorithm, with ILS runs for kWindow consecutive values of k made at the same time. As soon as one
+	//value of k is found to be feasible, the runs for all larger values are cancelled. Runs for smaller values of k
+	//carry on to the end of their budget, since they may still become feasible. The smallest feasible k is returned
+	//in k, along with its solution. If no k in the window is feasible, the next kWindow values are tried, and so on
+	int j, l, numK, maxK = ctx.inst->addresses.size();
+	bool allDone;
+	SOL S = SOL();
+	foundFeas = false;
+	while (k <= maxK) {
+		numK = min(kWindow, maxK - k + 1);
+		if (ctx.verbosity >= 1) cout << "\nUsing ILS to find a feasible solution using " << k << " to " << k + numK - 1 << " buses concurrently:" << endl;
+		//Each run has its own context, seeded from the caller's generator. The runs report back through the slots only,
+		//since output from several threads would be interleaved
+		vector<KSLOT> slots(numK);
+		vector<thread> workers;
+		for (j = 0; j < numK; j++) {
+			slots[j].k = k + j;
+			slots[j].ctx = ctx;
+			slots[j].ctx.rng.seed(ctx.rng());
+			slots[j].ctx.verbosity = 0;
+			slots[j].ctx.pool = NULL;
+			slots[j].ctx.lsPool = NULL;
+			clearEvalCounts(slots[j].ctx);
+			slots[j].foundFeas = false;
+			slots[j].cancel = false;
+			slots[j].feasible = false;
+			slots[j].done = false;
+		}
+		for (j = 0; j < numK; j++) workers.push_back(thread(runKSlot, ref(slots[j])));
+		//Now watch the runs, cancelling those that are no longer needed
+		while (true) {
+			allDone = true;
+			for (j = 0; j < numK; j++) {
+				if (slots[j].feasible) {
+					for (l = j + 1; l < numK; l++) slots[l].cancel = true;
+				}
+				if (!slots[j].done) allDone = false;
+			}
+			if (allDone) break;
+			this_thread::sleep_for(chrono::milliseconds(5));
+		}
+		for (j = 0; j < numK; j++) workers[j].join();
+		for (j = 0; j < numK; j++) addEvalCounts(ctx, slots[j].ctx);
+		if (ctx.verbosity >= 1) {
+			for (j = 0; j < numK; j++) {
+				cout << "  k = " << setw(3) << slots[j].k << ": ";
+				if (slots[j].cancel) cout << "cancelled (a smaller k is feasible)";
+				else if (slots[j].foundFeas) cout << "feasible, cost = " << slots[j].S.cost;
+				else cout << "no feasible solution found";
+				cout << "\n";
+			}
+		}
+		for (j = 0; j < numK; j++) {
+			if (slots[j].foundFeas) {
+				k = slots[j].k;
+				foundFeas = true;
+				return slots[j].S;
+			}
+		}
+		S = slots[numK - 1].S;
+		k += numK;
+	}
+	return S;
+}
+
+//Names of the local search operators, indexed by move type
+const char *opNames[8] = { "", "ToEmptyRoute", "SectionInsert", "SectionSwap", "StopSwap", "Inversion", "OrOpt", "StopCopy" };
+
+void printEvalCounts(const SolverContext &ctx) {
+	//Reports how much of the local search's inter-route neighbourhood was skipped by the capacity and cost bounds
+	cout << "Local search inter-route moves: " << ctx.ls.evalCnt << " considered, " << ctx.ls.evalFeasCnt << " within capacity, " << ctx.ls.evalDoneCnt << " evaluated\n";
+}
+
+void printOpStats(const SolverContext &ctx) {
+	//Reports the statistics gathered on each local search operator
+	cout << "\nMove  Operator          Evaluated    Applied     AvgGain     Time(ms)\n";
+	cout << "----------------------------------------------------------------------\n";
+	for (int t = 1; t <= 7; t++) {
+		const OPSTATS &op = ctx.ls.ops[t];
+		cout << setw(4) << t << "  " << left << setw(14) << opNames[t] << right << setw(13) << op.evals << setw(11) << op.wins
+			<< setw(12) << (op.wins > 0 ? op.gain / op.wins : 0.0) << setw(13) << op.time * 1000.0 << "\n";
+	}
+}
+
+void writeOpStats(const SolverContext &ctx, const string &infile, int seed) {
+	//Appends the operator statistics to log-opstats.txt, one line per operator
+	ofstream opLog("log-opstats.txt", ios::app);
+	for (int t = 1; t <= 7; t++) {
+		const OPSTATS &op = ctx.ls.ops[t];
+		opLog << infile << "\t" << seed << "\t" << (ctx.useVND ? "VND" : "All") << "\t" << t << "\t" << opNames[t] << "\t"
+			<< op.evals << "\t" << op.wins << "\t" << op.gain << "\t" << op.time << "\n";
+	}
+}
 
 //Info output if different no parameters used
 void usage() {
@@ -116,7 +327,7 @@ void usage() {
 	cout << "--------------------\n";
 	cout << "USAGE:\n"
 		<< "---- Compulsory -------------------------------------------\n"
-		<< "-i  <inFileName>         (must be a .bus file in the correct format. Do not include extension)\n"
+		<< "-i  <inFileName>         (must be a .bus file in the correct format, or a .busbin file made by the converter. Do not include extension. If both exist, the .busbin file is used unless it is older than the .bus file)\n"
 		<< "---- Optional ---------------------------------------------\n"
 		<< "-m  <double>             (Maximum bus journey time in minutes. Default = 45.0)\n"
 		<< "-c                       (Maximum bus capacity. Default = 70)\n"
@@ -124,9 +335,18 @@ void usage() {
 		<< "-D  <double>             (Discrete level. Minimum number of secs between each solution in the Pareto front. Larger values make runs faster but less accurate. Default = 10.0)\n"
 		<< "-M                       (If present, bus stop subsets in Stage-1 must be minimal set coverings; else not.)\n"
 		<< "-S                       (If present, only Stage 1 of the algorithm is run.)\n"
+		<< "-R                       (If present, stops whose addresses are all at least as close to some other stop are removed from the instance before solving, and any stop left as the only one within reach of an address is made compulsory. This can rule out the best routes.)\n"
 		<< "------------\n"
 		<< "-d  <double> <double>    (Dwell time coefficients, seconds-per-passenger and seconds-per-stop resp. Defaults = 5.0 and 15.0)\n"
 		<< "-r  <int>                (Random seed. Default = 1)\n"
+		<< "-g  <int>                (Granular local search. Inter-route inserts and swaps are only evaluated if they join a stop to one of its g nearest stops. Default = 0 (all moves evaluated))\n"
+		<< "-F  <int>                (First-improvement local search. Route pairs are examined in a random order and each step does the best of the first F improving moves found. -P has no effect when this is used. Default = 0 (each step does the best move overall))\n"
+		<< "-V                       (If present, the local search tries its operators one at a time, ordered by the reduction in cost each has given per second of evaluation, and only moves on to the next when the current one has no improving move. Overrides -F and -P)\n"
+		<< "-x                       (If present, the local search's insertion scans use scalar code only, even if the CPU supports AVX2.)\n"
+		<< "-b                       (If present, the set covering procedures hold each stop's addresses as a bitset and count uncovered addresses with popcounts, rather than using lists. Suited to instances with up to a few thousand addresses)\n"
+		<< "-K  <int>                (Number of values of k tried concurrently in Stage 1. Runs for larger k are cancelled when a smaller k becomes feasible. Each run uses -j threads of its own, so K x j threads are used in all. Default = 1)\n"
+		<< "-j  <int>                (Number of threads. In Stage 1, this many independent ILS runs are made in parallel for each k and the best is kept. In Stage 2, the neighbours of each archive solution are formed in parallel. Default = 1)\n"
+		<< "-P                       (If present, the -j threads are used inside each local search instead, each evaluating part of the neighbourhood. Stage 1 then runs one ILS per k and Stage 2 forms neighbours one at a time. Results depend on -r but not on -j (including -j 1))\n"
 		<< "-k  <int>                (Number of buses k to start at. Default is the lower bound (numStudents divided by busCapacity, rounded up to nearest integer)\n"
 		<< "-v                       (Verbosity. Repeat for more output to the screen)\n"
 		<< "------------------------------------------------------------\n";
@@ -141,17 +361,30 @@ int main(int argc, char *argv[]){
 	}
 
 	//Determine run variables and set default values
-	int i, totalTime, k = -1, seed = 1;
+	int i, totalTime, k = -1, seed = 1, kWindow = 1;
 	string infile;
 	bool foundFeas;
-	verbosity = 0;
-	dwellPerPassenger = 5.0;
-	discreteLevel = 10.0;
-	timePerK = 10;
-	dwellPerStop = 15.0;
-	maxBusCapacity = 70;
-	useMinCoverings = false;
-	bool stageOneOnly = false;
+	Instance inst;
+	SolverContext ctx;
+	ctx.inst = &inst;
+	ctx.verbosity = 0;
+	ctx.dwellPerPassenger = 5.0;
+	ctx.discreteLevel = 10.0;
+	ctx.timePerK = 10;
+	ctx.dwellPerStop = 15.0;
+	ctx.maxBusCapacity = 70;
+	ctx.useMinCoverings = false;
+	ctx.numThreads = 1;
+	ctx.pool = NULL;
+	ctx.lsPool = NULL;
+	ctx.firstImproving = 0;
+	ctx.useVND = false;
+	ctx.granularity = 0;
+	ctx.isCandidate = NULL;
+	ctx.useSIMD = true;
+	ctx.useBitCovering = false;
+	clearEvalCounts(ctx);
+	bool stageOneOnly = false, parallelLS = false, reduce = false;
 	double maxJourneyTimeMins = 45.0;
 	list<SOL> A;
 		
@@ -162,11 +395,37 @@ int main(int argc, char *argv[]){
 				seed = atoi(argv[++i]);
 			}
 			else if (strcmp("-t", argv[i]) == 0) {
-				timePerK = atoi(argv[++i]);
+				ctx.timePerK = atoi(argv[++i]);
 			}
 			else if (strcmp("-d", argv[i]) == 0) {
-				dwellPerPassenger = atof(argv[++i]);
-				dwellPerStop = atof(argv[++i]);
+				ctx.dwellPerPassenger = atof(argv[++i]);
+				ctx.dwellPerStop = atof(argv[++i]);
+			}
+			else if (strcmp("-j", argv[i]) == 0) {
+				ctx.numThreads = atoi(argv[++i]);
+				if (ctx.numThreads < 1) ctx.numThreads = 1;
+			}
+			else if (strcmp("-g", argv[i]) == 0) {
+				ctx.granularity = atoi(argv[++i]);
+			}
+			else if (strcmp("-x", argv[i]) == 0) {
+				ctx.useSIMD = false;
+			}
+			else if (strcmp("-b", argv[i]) == 0) {
+				ctx.useBitCovering = true;
+			}
+			else if (strcmp("-F", argv[i]) == 0) {
+				ctx.firstImproving = atoi(argv[++i]);
+			}
+			else if (strcmp("-V", argv[i]) == 0) {
+				ctx.useVND = true;
+			}
+			else if (strcmp("-P", argv[i]) == 0) {
+				parallelLS = true;
+			}
+			else if (strcmp("-K", argv[i]) == 0) {
+				kWindow = atoi(argv[++i]);
+				if (kWindow < 1) kWindow = 1;
 			}
 			else if (strcmp("-k", argv[i]) == 0) {
 				k = atoi(argv[++i]);
@@ -178,22 +437,40 @@ int main(int argc, char *argv[]){
 				stageOneOnly = true;
 			}
 			else if (strcmp("-v", argv[i]) == 0) {
-				verbosity++;
+				ctx.verbosity++;
 			}
 			else if (strcmp("-c", argv[i]) == 0) {
-				maxBusCapacity = atoi(argv[++i]);
+				ctx.maxBusCapacity = atoi(argv[++i]);
 			}
 			else if (strcmp("-D", argv[i]) == 0) {
-				discreteLevel = atof(argv[++i]);
+				ctx.discreteLevel = atof(argv[++i]);
+			}
+			else if (strcmp("-R", argv[i]) == 0) {
+				reduce = true;
 			}
 			else if (strcmp("-M", argv[i]) == 0) {
-				useMinCoverings = true;
+				ctx.useMinCoverings = true;
 			}
 			else if (strcmp("-i", argv[i]) == 0) {
-				//read in the problem file (in the .bus format) and construct the relevant arrays.
+				//read in the problem file and construct the relevant arrays. A binary version of the file (.busbin,
+				//produced by the converter) is used in preference to the .bus text file when one exists, unless the
+				//.bus file has been changed since the .busbin file was made
 				infile = argv[++i];
-				string infileWithExtension = infile + ".bus";
-				readInput(infileWithExtension);
+				string infileWithExtension = infile + ".busbin";
+				bool binaryIsStale = isOlderFile(infileWithExtension, infile + ".bus");
+				if (binaryIsStale && isBinaryInput(infileWithExtension)) {
+					cout << "Warning. " << infileWithExtension << " is older than " << infile << ".bus, so the .bus file is being read instead\n";
+				}
+				if (!binaryIsStale && isBinaryInput(infileWithExtension)) {
+					readBinaryInput(inst, infileWithExtension);
+				}
+				else if (isBinaryInput(infile)) {
+					readBinaryInput(inst, infile);
+				}
+				else {
+					infileWithExtension = infile + ".bus";
+					readInput(inst, infileWithExtension);
+				}
 			}
 			else {
 				cout << "Invalid input statement. ("<< argv[i] <<"). Please try again.\n";
@@ -209,42 +486,65 @@ int main(int argc, char *argv[]){
 	}
 
 	//Convert max journey time to seconds to be consistent with input files
-	maxJourneyTime = maxJourneyTimeMins * 60.0;
+	ctx.maxJourneyTime = maxJourneyTimeMins * 60.0;
 
 	//By default the excess weight is set to the max journey time (in seconds)
-	excessWeight = maxJourneyTime;
+	ctx.excessWeight = ctx.maxJourneyTime;
 
 	//Set seed and start the clock	
-	srand(seed);
-	time_t startTime, endTime;
-	startTime = clock();
+	ctx.rng.seed(seed);
+	//(Wall-clock time is used for reporting, since clock() adds up the time of all threads)
+	chrono::steady_clock::time_point startTime, endTime;
+	startTime = chrono::steady_clock::now();
+
+	//Start the threads used by the parallel parts of the algorithm (if any)
+	ThreadPool pool(ctx.numThreads);
+	if (parallelLS) ctx.lsPool = &pool;
+	else if (ctx.numThreads > 1) ctx.pool = &pool;
+	if (kWindow > 1 && ctx.numThreads * kWindow > (int)thread::hardware_concurrency()) {
+		cout << "Warning. -K " << kWindow << " with -j " << ctx.numThreads << " runs " << ctx.numThreads * kWindow << " threads in Stage 1, more than the " << thread::hardware_concurrency() << " this machine has\n";
+	}
+
+	//Remove dominated bus stops from the instance (if wanted)
+	if (reduce) reduceInstance(inst);
 
 	//Determine any bus stops that are outliers (i.e. far from the school) by populating the isOutlier vector
-	getOutliers();
+	getOutliers(ctx);
+
+	//Build the candidate lists used by granular neighbourhoods in the local search (if wanted)
+	FlatMatrix<char> isCandidate;
+	makeCandidateLists(ctx, isCandidate);
 
 	//Determine initial number of buses kInit. This is either the LB or specified by the user 
-	kInit = int(ceil(totalPassengers / double(maxBusCapacity)));
-	if (k < kInit) k = kInit;
+	ctx.kInit = int(ceil(inst.totalPassengers / double(ctx.maxBusCapacity)));
+	if (k < ctx.kInit) k = ctx.kInit;
 
 	//Algorithm Stage 1: Find a feasible solution --------------------------------------------------------
 	foundFeas = false;
 	SOL S;
-	while(k <= addresses.size()) {
-		if (verbosity >= 1) cout << "\nUsing ILS to find a feasible solution using " << k << " buses:" << endl;
-		S = ILS(k, foundFeas);
-		if (foundFeas) break;
-		else  k++;
+	if (kWindow > 1) {
+		S = concurrentKSearch(ctx, k, kWindow, foundFeas);
+	}
+	else {
+		while(k <= inst.addresses.size()) {
+			if (ctx.verbosity >= 1) cout << "\nUsing ILS to find a feasible solution using " << k << " buses:" << endl;
+			S = ILS(ctx, k, foundFeas);
+			if (foundFeas) break;
+			else  k++;
+		}
 	}
 	
 	//Record how long it took to find a feasible solution and output some info
-	endTime = clock();
-	int midTime = (int)(((endTime - startTime) / double(CLOCKS_PER_SEC)) * 1000);
-	if (verbosity >= 1) {
+	endTime = chrono::steady_clock::now();
+	int midTime = (int)chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+	if (ctx.verbosity >= 1) {
 		cout << "\nILS method completed in " << midTime << " ms\n";
-		checkSolutionValidity(S, true);
-		if (verbosity >= 2) {
+		printEvalCounts(ctx);
+		checkSolutionValidity(ctx, S, true);
+		if (ctx.verbosity >= 2) {
+			printOpStats(ctx);
 			cout << "\nHere is the best solution found by ILS:\n\n";
-			printSln(S);
+			printSln(ctx, S);
 		}
 	}
 
@@ -252,44 +552,48 @@ int main(int argc, char *argv[]){
 		//We are now running Stage 2 (the multi-objective part) too. First we Add this single feasible solution to the archive A
 		A.push_back(S);
 		//Now do the multiobjective optimisation
-		doMultiObjOptimisation(A);
+		doMultiObjOptimisation(ctx, A);
 		//Stop the clock
-		endTime = clock();
-		totalTime = (int)(((endTime - startTime) / double(CLOCKS_PER_SEC)) * 1000);
-		if (verbosity >= 1) {
+		endTime = chrono::steady_clock::now();
+		totalTime = (int)chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+		if (ctx.verbosity >= 1) {
 			cout << "\nRun completed in " << totalTime << " ms" << endl;
+			printEvalCounts(ctx);
+			if (ctx.verbosity >= 2) printOpStats(ctx);
 		}
 	}
 	cout << "Run details have been appended to log-results.txt" << endl;
+	cout << "Local search operator statistics have been appended to log-opstats.txt" << endl;
+	writeOpStats(ctx, infile, seed);
 
 	//Finally, output some information on the run to a log file
 	ofstream resultsLog("log-results.txt", ios::app);
 	double stopsPerAddr, addrPerStop;
 	int numSingletonStops;
-	calcMetrics(stopsPerAddr, addrPerStop);
-	numSingletonStops = calcSingletonStops(S);
+	calcMetrics(inst, stopsPerAddr, addrPerStop);
+	numSingletonStops = calcSingletonStops(inst, S);
 	
 	//Information on the problem instance
 	resultsLog << infile << "\t"
-		<< stops.size() << "\t"
-		<< addresses.size() << "\t"
-		<< totalPassengers << "\t"
-		<< distUnits << "\t"
-		<< maxWalkDist << "\t"
-		<< minEligibilityDist << "\t"
+		<< inst.stops.size() << "\t"
+		<< inst.addresses.size() << "\t"
+		<< inst.totalPassengers << "\t"
+		<< inst.distUnits << "\t"
+		<< inst.maxWalkDist << "\t"
+		<< inst.minEligibilityDist << "\t"
 		<< stopsPerAddr << "\t"
 		<< addrPerStop << "\t"
-		<< dwellPerPassenger << "\t"
-		<< dwellPerStop << "\t"
-		<< maxBusCapacity << "\t";
+		<< ctx.dwellPerPassenger << "\t"
+		<< ctx.dwellPerStop << "\t"
+		<< ctx.maxBusCapacity << "\t";
 
 	//Information on the run options used
 	resultsLog << maxJourneyTimeMins << "\t"
 		<< seed << "\t"
-		<< kInit << "\t"
-		<< timePerK << "\t"
-		<< discreteLevel << "\t";
-	if (useMinCoverings)resultsLog << "minCoveringsOnly\t";
+		<< ctx.kInit << "\t"
+		<< ctx.timePerK << "\t"
+		<< ctx.discreteLevel << "\t";
+	if (ctx.useMinCoverings)resultsLog << "minCoveringsOnly\t";
 	else				resultsLog << "AllCoverings\t";
 
 	//Information on Stage 1's solution
@@ -318,17 +622,17 @@ int main(int argc, char *argv[]){
 		cout << "Costs of solutions in the final archive set have been appended to log-archive.txt" << endl;
 		ofstream archiveLog("log-archive.txt", ios::app);
 		for (AIt = APrime.begin(); AIt != APrime.end(); ++AIt) {
-			archiveLog << (*AIt).costWalk / double(totalPassengers) / 60.0 << "\t";
+			archiveLog << (*AIt).costWalk / double(inst.totalPassengers) / 60.0 << "\t";
 		}
 		archiveLog << "\n";
 		for (AIt = APrime.begin(); AIt != APrime.end(); ++AIt) {
 			archiveLog << (*AIt).cost / double(k) / 60.0 << "\t";
 		}
 		archiveLog << "\n";
-		if(verbosity >= 2) {
+		if(ctx.verbosity >= 2) {
 			cout << "\n\nHere are the " << APrime.size() << " feasible solutions in the final archive set: \n\n";
 			for (AIt = APrime.begin(); AIt != APrime.end(); ++AIt) {
-				printSln(*AIt);
+				printSln(ctx, *AIt);
 			}
 		}
 	}
@@ -16,6 +16,17 @@
 #include <cfloat>
 #include <iomanip>
 #include <sstream>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "matrix.h"
+#include "bitmatrix.h"
+#include "bucketqueue.h"
+#include "posindex.h"
+#include "ragged.h"
+#include "threadpool.h"
 
 using namespace std;
 
@@ -34,18 +45,55 @@ struct ADDR {
 	int numPass;		//Number of passengers
 };
 
+struct WALKS {
+	//Compressed sparse row (CSR) store of the walks between addresses and their adjacent stops (those within the maximum
+	//walking distance). The stops adjacent to address a are in positions start[a],...,start[a + 1] - 1 of the remaining
+	//arrays, in non-descending order of walk time
+	vector<int> start;					//Row offsets (one per address, plus one)
+	vector<int> stop;					//Adjacent stop
+	vector<double> time;				//Walk time (in seconds) from the address to the stop
+	vector<double> dist;				//Walk distance from the address to the stop
+
+	inline int numAdj(int a) const { return start[a + 1] - start[a]; }
+	inline int adjStop(int a, int j) const { return stop[start[a] + j]; }
+	inline double adjTime(int a, int j) const { return time[start[a] + j]; }
+	double timeTo(int a, int v) const {
+		//Walk time from address a to stop v (DBL_MAX if v is not adjacent to a)
+		for (int p = start[a]; p < start[a + 1]; p++) if (stop[p] == v) return time[p];
+		return DBL_MAX;
+	}
+};
+
+struct COVERSETS {
+	//Compressed sparse row store of the addresses adjacent to each stop (the sets used by the set covering procedures).
+	//The addresses covered by stop v are in positions start[v],...,start[v + 1] - 1 of addr, in ascending order
+	vector<int> start;					//Row offsets (one per stop, plus one)
+	vector<int> addr;					//Covered address
+
+	inline int size(int v) const { return start[v + 1] - start[v]; }
+	inline const int *begin(int v) const { return &addr[start[v]]; }
+	inline const int *end(int v) const { return &addr[start[v + 1]]; }
+};
+
 struct SOL {
-	vector<vector<int> > items;			//List of stops on each route
-	vector<vector<int> > W;				//Number boarding in each instance of a stop in items
-	vector<vector<int> > routeOfStop;	//Gives the route number of each stop (could be blank or have multiple elements)
+	//A solution. The routes (items) and the numbers boarding (W) are rows of RaggedArrays, so each lives in a single buffer,
+	//and assigning one SOL to another copies these buffers into the memory the destination already has
+	RaggedArray<int> items;				//List of stops on each route
+	RaggedArray<int> W;					//Number boarding in each instance of a stop in items (laid out as items)
+	RaggedArray<int> routeOfStop;		//Gives the route number of each stop (could be blank or have multiple elements)
 	vector<bool> stopUsed;				//Tells us whether the stop is being used or not
 	vector<int> assignedTo;				//Tells us, for each address, the assigned bus stop (must be the closest available)
 	vector<int> numBoarding;			//The total number of students who are boarding at each stop
 	vector<double> routeLen;			//The total length (in seconds) of each bus's route, including dwell times
 	vector<int> passInRoute;			//The total numer of students assigned to each route
 	vector<bool> hasOutlier;			//True if route i has one or more outlier stop, false otherwise
-	vector<vector<int> > posInRoute;	//Element i, j indicates the position of stop i in route j (set to -1 if i is not in j)
-	vector<vector<bool> > commonStop;	//Element i, j is true if bus-routes i and j share a common stop, false otherwise
+	PosIndex posInRoute;				//posInRoute.get(i, j) is the position of stop i in route j (-1 if i is not in j)
+	BitMatrix routeStops;				//Row r is the set of stops in route r
+	BitMatrix commonStop;				//Element i, j is true if bus-routes i and j share a common stop, false otherwise
+	RaggedArray<double> travelPre;		//Element r, p is the travel time from the first stop of route r to its p'th stop
+	RaggedArray<double> travelPreF;		//As travelPre, but with every edge of route r traversed in the reverse direction
+	RaggedArray<double> dwellPre;		//Element r, p is the total dwell time at the first p stops of route r
+	RaggedArray<int> passPre;			//Element r, p is the total number boarding at the first p stops of route r
 	double cost;						//Cost of the solution (sum of route lengths (in seconds), with weighting)
 	double costWalk;					//Cost of the solution in terms of total walk time of all passengers
 	int numFeasibleRoutes;				//Number of feasible routes in the solution (i.e. <= the specified maximum route length)
@@ -68,6 +116,116 @@ struct EVALINFO {
 	int passISection;				//Total passengers in I Section
 };
 
+struct MOVE {
+	//A neighbourhood move found by the local search. Sections (S[x][y1]...S[x][y2-1]) and (S[i][j1]...S[i][j2-1]) are
+	//used by the inter-route operators; y1, y2 and z by the intra-route operators (see localSearch())
+	int type;						//Neighbourhood operator (1,...,7), or 0 if there is no move
+	int x, y1, y2, i, j1, j2, z;
+	bool flippedX;					//Tells us whether X section should be flipped
+	bool flippedI;					//Tells us whether I section should be flipped
+	double delta;					//Change in the solution's cost if the move is made
+	int numTied;					//Number of moves seen with this delta (used to break ties randomly)
+};
+
+struct OPSTATS {
+	//Statistics on one local search operator (move type)
+	long evals;							//Number of moves of this type evaluated
+	long wins;							//Number of these that were applied
+	double gain;						//Total reduction in cost from the applied moves
+	double time;						//Seconds spent evaluating moves of this type
+};
+
+struct LSWORKSPACE {
+	//Working storage for evaluating local search moves. Each thread evaluating moves at the same time needs its own
+	mt19937 rng;						//Breaks ties between the moves evaluated by a worker thread (see refreshMovesInParallel())
+	vector<double> insLen, insLenF;		//Lengths of a route after inserting a section at each point (see insertscan.h)
+	vector<double> insCost;				//Extra travel time from inserting a stop at each point of a route (see insertscan.h)
+	long evalCnt;						//Number of inter-route section swaps/inserts considered by the local search
+	long evalFeasCnt;					//Number of these that respect the bus capacities (the rest are skipped unseen)
+	long evalDoneCnt;					//Number of these whose cost was actually evaluated
+	OPSTATS ops[8];						//Statistics on each operator, indexed by move type (1-7)
+};
+
+struct Instance {
+	//A problem instance. It is filled in once by readInput() (or readBinaryInput()) and is read-only after that, so a single
+	//Instance can be shared by any number of solver runs
+	vector<STOP> stops;
+	vector<ADDR> addresses;
+	FlatMatrix<double> dDist;			//Driving distance between each pair of stops
+	FlatMatrix<double> dTime;			//Driving time (in seconds) between each pair of stops
+	WALKS walks;						//Gives the stops adjacent to each address, with walk times and distances
+	vector<vector<int> > stopAdjList;	//Gives a list of addresses adjacent to each stop
+	vector<vector<double> > stopAdjTime;	//Walk time from each address in stopAdjList to the stop
+	COVERSETS coverSets;				//The same lists in ascending order of address, for the set covering procedures
+	BitMatrix coverBits;				//The same sets as bitsets: bit a of row v is one if address a is adjacent to stop v
+	int totalPassengers;
+	string distUnits;
+	double maxWalkDist;
+	double minEligibilityDist;
+};
+
+struct RUNPARAMS {
+	//The run parameters of the solver. Kept apart from the rest of SolverContext so that they can be copied as a whole into
+	//the context of each worker thread (see setUpWorkerContext())
+	const Instance *inst;
+	int maxBusCapacity;
+	int kInit;
+	int timePerK;
+	int verbosity;
+	double dwellPerPassenger;
+	double dwellPerStop;
+	double excessWeight;
+	double maxJourneyTime;
+	double discreteLevel;
+	bool useMinCoverings;
+	int numThreads;						//Number of worker threads to use (-j)
+	int granularity;					//Length of each stop's candidate list in the local search (0 = no candidate lists)
+	bool useSIMD;						//Use the AVX2 insertion kernels when the CPU supports them (see insertscan.h)
+	bool useBitCovering;				//Set covering procedures work on the bitsets in coverBits rather than the lists (-b)
+	int firstImproving;					//If > 0, each local search step does the best of the first this-many improving moves found (-F)
+	bool useVND;						//Local search tries one operator at a time, in adaptive order (-V)
+	const FlatMatrix<char> *isCandidate;	//Element u, v is 1 if v is one of u's nearest stops or vice versa (see makeCandidateLists()). NULL if granularity is 0
+	vector<bool> isOutlier;				//True for compulsory stops that are too far from the school (set by getOutliers())
+};
+
+struct SolverContext : RUNPARAMS {
+	//Everything a run of the solver needs other than the instance: the run parameters, the thread pools, the random number
+	//generator and the scratch buffers used by the various procedures. Every run (and every thread) must have its own context.
+	//Thread pools (these belong to the thread that owns the context)
+	ThreadPool *pool;					//Threads shared by the parallel parts of the algorithm (NULL if running on one thread)
+	ThreadPool *lsPool;					//If not NULL, each local search evaluates its neighbourhoods on these threads (-P)
+	//Random number generator
+	mt19937 rng;
+	//Scratch buffers
+	vector<int> tempVec1, tempVec2, tempVec3, tempVec4;		//Used by the local search
+	vector<MOVE> pairMove, routeMove;						//Best move for each pair of routes and each route (the local search's move cache)
+	vector<char> dirtyRoute;								//Routes changed since their moves were cached
+	vector<int> dirtyEntries;								//Move cache entries waiting to be re-evaluated
+	vector<int> moveOrder, moveStamp, routeStamp;			//Visiting order and ages of the move cache entries (used when firstImproving > 0)
+	vector<MOVE> opMove;									//Move cache of each operator when useVND is set
+	vector<int> opStamp, opOrder;							//Ages of the opMove entries and the order the operators are tried in
+	LSWORKSPACE ls;											//Used when evaluating moves in this thread. Also totals the evaluation counts
+	vector<LSWORKSPACE> lsWorkers;							//Used by the threads of lsPool
+	vector<int> Y, tempVec, perm;							//Used by the set covering procedures
+	vector<int> numUncovered;								//Number of uncovered addresses adjacent to each stop (see generateNewCovering())
+	vector<char> addrCovered;								//Tells us whether each address is covered (see generateNewCovering())
+	BucketQueue coverQueue;									//Stops keyed on numUncovered, for the greedy set covering heuristic
+	BitMatrix coverWork;									//Address bitsets used by the set covering procedures when useBitCovering is set
+	vector<int> stopNeed, needStops, needAddrs;				//Used by repairCovering(). stopNeed is all zero between calls
+	vector<char> addrNeed;									//Used by repairCovering(). All zero between calls
+	vector<int> stopsToPack, weightOfStopsToPack;			//Stops (and their weights) waiting to be bin packed
+	vector<int> tVec, tVec2;								//Used when adding and removing stops in the multiobjective phase
+
+	inline int randInt(int n) {
+		//Returns a random integer in the range 0,...,(n - 1)
+		return int(rng() % (unsigned int)n);
+	}
+	inline double randUnit() {
+		//Returns a random real in the range [0, 1]
+		return rng() / double(rng.max());
+	}
+};
+
 #include "input.h"
 #include "optimiser.h"
 #include "initsol.h"
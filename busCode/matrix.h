@@ -0,0 +1,111 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stddef.h>
+#include <string.h>
+#include <new>
+
+#define MATRIX_ALIGN 64
+
+//A dense row-major matrix held in a single allocation. Each row is padded to a whole number of cache lines
+//(rowStride() elements) and the first row starts on a cache-line boundary, so element (i, j) is found with a
+//single multiply-add rather than by chasing a row pointer. A matrix can also be a read-only view onto memory
+//owned by someone else (e.g. a memory-mapped .busbin file), in which case it is never freed or written to.
+//T must be a trivially copyable type.
+template <typename T>
+class FlatMatrix {
+public:
+	FlatMatrix() : numRows(0), numCols(0), stride(0), data(NULL), owned(false) {}
+
+	FlatMatrix(const FlatMatrix &other) : numRows(0), numCols(0), stride(0), data(NULL), owned(false) {
+		copyFrom(other);
+	}
+
+	FlatMatrix &operator=(const FlatMatrix &other) {
+		if (this != &other) copyFrom(other);
+		return *this;
+	}
+
+	~FlatMatrix() {
+		release();
+	}
+
+	void resize(int rows, int cols, T fill) {
+		//(Re)allocates the matrix as rows x cols with every element (including the padding) set to fill
+		release();
+		numRows = rows;
+		numCols = cols;
+		stride = strideFor(cols);
+		if (size_t(numRows) * stride > 0) {
+			data = (T *)::operator new(size_t(numRows) * stride * sizeof(T), std::align_val_t(MATRIX_ALIGN));
+			owned = true;
+		}
+		for (size_t k = 0; k < size_t(numRows) * stride; k++) data[k] = fill;
+	}
+
+	void adopt(const T *external, int rows, int cols, int rowStride) {
+		//Makes this matrix a view onto external memory laid out in the same way. The memory must outlive the matrix
+		release();
+		numRows = rows;
+		numCols = cols;
+		stride = rowStride;
+		data = (T *)external;
+		owned = false;
+	}
+
+	inline T &operator()(int i, int j) {
+		return data[size_t(i) * stride + j];
+	}
+
+	inline const T &operator()(int i, int j) const {
+		return data[size_t(i) * stride + j];
+	}
+
+	inline T *row(int i) {
+		return data + size_t(i) * stride;
+	}
+
+	inline const T *row(int i) const {
+		return data + size_t(i) * stride;
+	}
+
+	inline int rows() const { return numRows; }
+	inline int cols() const { return numCols; }
+	inline int rowStride() const { return stride; }
+	inline bool isView() const { return data != NULL && !owned; }
+
+	static int strideFor(int cols) {
+		//Number of elements in a row of cols elements once padded to a whole number of cache lines
+		int perLine = MATRIX_ALIGN / sizeof(T) > 0 ? MATRIX_ALIGN / sizeof(T) : 1;
+		return (cols + perLine - 1) / perLine * perLine;
+	}
+
+private:
+	int numRows;
+	int numCols;
+	int stride;
+	T *data;
+	bool owned;
+
+	void release() {
+		if (owned) ::operator delete(data, std::align_val_t(MATRIX_ALIGN));
+		data = NULL;
+		owned = false;
+		numRows = numCols = stride = 0;
+	}
+
+	void copyFrom(const FlatMatrix &other) {
+		//Copies always own their memory, even when other is a view
+		release();
+		numRows = other.numRows;
+		numCols = other.numCols;
+		stride = other.stride;
+		if (size_t(numRows) * stride > 0) {
+			data = (T *)::operator new(size_t(numRows) * stride * sizeof(T), std::align_val_t(MATRIX_ALIGN));
+			owned = true;
+			memcpy(data, other.data, size_t(numRows) * stride * sizeof(T));
+		}
+	}
+};
+
+#endif //MATRIX_H
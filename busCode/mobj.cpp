@@ -1,30 +1,5 @@
 #include "mobj.h"
 
-extern vector<STOP> stops;
-extern vector<ADDR> addresses;
-extern vector<bool> isOutlier;
-extern vector<vector<double> > dDist;
-extern vector<vector<double> > dTime;
-extern vector<vector<double> > wDist;
-extern vector<vector<double> > wTime;
-extern vector<vector<int> > stopAdjList;
-extern vector<vector<int> > addrAdjList;
-extern vector<vector<bool> > addrStopAdj;
-extern int totalPassengers, maxBusCapacity;
-extern double maxWalkDist;
-extern double minEligibilityDist;
-extern string distUnits;
-extern double dwellPerPassenger;
-extern double dwellPerStop;
-extern double excessWeight;
-extern double maxJourneyTime;
-extern bool useMinCoverings;
-extern double discreteLevel;
-extern int verbosity;
-extern vector<int> stopsToPack;
-extern vector<int> weightOfStopsToPack;
-vector<int> tVec, tVec2;
-
 bool compareSlns(const SOL &lhs, const SOL &rhs) {
 	return lhs.costWalk < rhs.costWalk;
 }
@@ -46,7 +21,7 @@ void printDetails(list<SOL> &A, list<bool> &L, int its) {
 	cout << its << ") Archive size |A| =  " << numInFront << ", num visited solutions = " << numVisited << ". " << numFeas << " of these are feasible" << endl;
 }
 
-bool chooseUnvisitedSolution(list<SOL> &A, list<bool> &visited, SOL &S) {
+bool chooseUnvisitedSolution(SolverContext &ctx, list<SOL> &A, list<bool> &visited, SOL &S) {
 	//Randomly chooses a member of the archive that has not yet been visited
 	list<SOL>::iterator AIt, AChosen;
 	list<bool>::iterator vIt, vChosen;
@@ -55,7 +30,7 @@ bool chooseUnvisitedSolution(list<SOL> &A, list<bool> &visited, SOL &S) {
 	int numChoices = 0;
 	while (vIt != visited.end()) {
 		if (*vIt == false) {
-			if (rand() % (numChoices + 1) == 0) {
+			if (ctx.randInt(numChoices + 1) == 0) {
 				vChosen = vIt;
 				AChosen = AIt;
 			}
@@ -76,13 +51,13 @@ bool chooseUnvisitedSolution(list<SOL> &A, list<bool> &visited, SOL &S) {
 	}
 }
 	
-void updateA(list<SOL> &A, list<bool> &visited, SOL &S) {
+void updateA(const SolverContext &ctx, list<SOL> &A, list<bool> &visited, SOL &S) {
 	//Procedure that updates a mutually non-dominating archive A with a solution S
 	list<SOL>::iterator AIt;
 	list<bool>::iterator vIt;
 	double k = double(S.items.size());
-	double s = double(totalPassengers);
-	double base = discreteLevel;
+	double s = double(ctx.inst->totalPassengers);
+	double base = ctx.discreteLevel;
 	AIt = A.begin();
 	vIt = visited.begin();
 	while (AIt != A.end()) {
@@ -122,29 +97,39 @@ void updateA(list<SOL> &A, list<bool> &visited, SOL &S) {
 	visited.push_back(false);
 }
 
-void calcSavingWhenAddingAStop(SOL &S, int v, double &saving, bool &addingStop) {
+void calcSavingWhenAddingAStop(const SolverContext &ctx, SOL &S, int v, double &saving, bool &addingStop) {
 	//Calculate the savings in walking distance (if any) when adding bus stop v to solution S
+	const vector<ADDR> &addresses = ctx.inst->addresses;
+	const WALKS &walks = ctx.inst->walks;
+	const vector<vector<int> > &stopAdjList = ctx.inst->stopAdjList;
+	const vector<double> &timeToV = ctx.inst->stopAdjTime[v];
 	saving = 0;
 	int j, addr;
+	double current;
 	for (j = 0; j < stopAdjList[v].size(); j++) {
 		addr = stopAdjList[v][j];
-		if (wTime[addr][v] < wTime[addr][S.assignedTo[addr]]) {
+		current = walks.timeTo(addr, S.assignedTo[addr]);
+		if (timeToV[j] < current) {
 			//Addr is closer to v than its current stop, so a saving can be made for all passengers at this address
-			saving += (wTime[addr][S.assignedTo[addr]] - wTime[addr][v]) * addresses[addr].numPass;
+			saving += (current - timeToV[j]) * addresses[addr].numPass;
 		}
 	}
 	if (saving > 0) addingStop = true;
 	else			addingStop = false; //Adding the stop makes no difference to peoples' walks
 }
 
-void addStop(int v, SOL &S, double saving) {
+void addStop(SolverContext &ctx, int v, SOL &S, double saving) {
+	const vector<ADDR> &addresses = ctx.inst->addresses;
+	const WALKS &walks = ctx.inst->walks;
+	const vector<vector<int> > &stopAdjList = ctx.inst->stopAdjList;
+	const vector<double> &timeToV = ctx.inst->stopAdjTime[v];
 	int i, j, u, x, r, c, addr;
 	//We are going to add a new stop v. First, we need to remove relevant passengers from their current stops and assign them to v
 	for (j = 0; j < stopAdjList[v].size(); j++) {
 		//Look at each address "addr" adjacent to v and consider the stop u it is currently assigned to
 		addr = stopAdjList[v][j];
 		u = S.assignedTo[addr];
-		if (wTime[addr][v] < wTime[addr][u]) {
+		if (timeToV[j] < walks.timeTo(addr, u)) {
 			//Addr is closer to v than u so a saving can be made. We do this by removing the x passengers of "addr" from occurences of u in S.W
 			x = addresses[addr].numPass;
 			S.numBoarding[v] += x;
@@ -152,7 +137,7 @@ void addStop(int v, SOL &S, double saving) {
 			S.assignedTo[addr] = v;
 			for (i = 0; i < S.routeOfStop[u].size(); i++) {
 				r = S.routeOfStop[u][i];
-				c = S.posInRoute[u][r];
+				c = S.posInRoute.get(u, r);
 				if (S.W[r][c] >= x) {
 					S.W[r][c] -= x;
 					break;
@@ -181,17 +166,23 @@ void addStop(int v, SOL &S, double saving) {
 		}
 	}
 	//Now use BPP style procedure to pack stop v into the solution.
-	binPacker(S.items, S.W, S.passInRoute, v, S.numBoarding[v]);
+	binPacker(ctx, S.items, S.W, S.passInRoute, v, S.numBoarding[v]);
 	//Having added v to the solution we now recalculate the auxiliary structures
-	repopulateAuxiliaries(S);
+	repopulateAuxiliaries(ctx, S);
 	//and, update the costs
-	S.cost = calcSolCostFromScratch(S);
+	S.cost = calcSolCostFromScratch(ctx, S);
 	S.costWalk -= saving;
 }
 
-void calcSavingWhenRemovingAStop(SOL &S, int v, double &saving, bool doRepair, bool &deletingStop) {
+void calcSavingWhenRemovingAStop(SolverContext &ctx, SOL &S, int v, double &saving, bool doRepair, bool &deletingStop) {
 	//Calculate the "savings" (which could be negative) of removing the non-compulsory stop v
-	int i, j, addr, u, x, y;
+	const vector<ADDR> &addresses = ctx.inst->addresses;
+	const WALKS &walks = ctx.inst->walks;
+	const vector<vector<int> > &stopAdjList = ctx.inst->stopAdjList;
+	const vector<vector<double> > &stopAdjTime = ctx.inst->stopAdjTime;
+	vector<int> &tVec = ctx.tVec, &tVec2 = ctx.tVec2;
+	int i, j, p, addr, u, x, y;
+	double current;
 	saving = 0;
 	if (doRepair) {
 		tVec.clear(); //Keeps a record of additional stops that are added (if any)
@@ -201,37 +192,39 @@ void calcSavingWhenRemovingAStop(SOL &S, int v, double &saving, bool doRepair, b
 		addr = stopAdjList[v][i];
 		if (S.assignedTo[addr] == v) {
 			//Addr is currently assigned to v, so we need to find another stop u for it (the closest used stop)
-			for (j = 0; j < addrAdjList[addr].size(); j++) {
-				u = addrAdjList[addr][j];
+			for (j = 0; j < walks.numAdj(addr); j++) {
+				u = walks.adjStop(addr, j);
 				if (S.stopUsed[u] && u != v) break; //Addr can be assigned to a stop u != v that is currently being used 
 			}
-			if (j >= addrAdjList[addr].size()) {
+			if (j >= walks.numAdj(addr)) {
 				//An additional stop is required for addr. Either find one, or end
 				if (!doRepair) {
 					deletingStop = false;
 					return;
 				}
 				//No used stop is suitable for addr, so we assign addr to the closest unused stop u != v instead
-				u = addrAdjList[addr][0];
-				if (u == v) u = addrAdjList[addr][1];
+				p = walks.adjStop(addr, 0) == v ? 1 : 0;
+				u = walks.adjStop(addr, p);
 				tVec.push_back(u);
 				S.stopUsed[u] = true;
 				tVec2.push_back(addr);
 				tVec2.push_back(v);
 				S.assignedTo[addr] = u;
-				saving += wTime[addr][v] * addresses[addr].numPass;
-				saving -= wTime[addr][u] * addresses[addr].numPass;
+				saving += stopAdjTime[v][i] * addresses[addr].numPass;
+				saving -= walks.adjTime(addr, p) * addresses[addr].numPass;
 				//We also need to check if the addition of u affects the walking distances from any other adjacent addresses
 				for (j = 0; j < stopAdjList[u].size(); j++) {
 					//Check if address x, which is currently assigned to stop y, is closer to stop u
 					x = stopAdjList[u][j];
 					y = S.assignedTo[x];
-					if (x != addr && y != v && wTime[x][u] < wTime[x][y]) {
+					if (x == addr || y == v) continue;
+					current = walks.timeTo(x, y);
+					if (stopAdjTime[u][j] < current) {
 						tVec2.push_back(x);
 						tVec2.push_back(y);
 						S.assignedTo[x] = u;
-						saving += wTime[x][y] * addresses[x].numPass;
-						saving -= wTime[x][u] * addresses[x].numPass;
+						saving += current * addresses[x].numPass;
+						saving -= stopAdjTime[u][j] * addresses[x].numPass;
 					}	
 				}
 			}
@@ -242,8 +235,8 @@ void calcSavingWhenRemovingAStop(SOL &S, int v, double &saving, bool doRepair, b
 					tVec2.push_back(v);
 					S.assignedTo[addr] = u;
 				}
-				saving += wTime[addr][v] * addresses[addr].numPass;
-				saving -= wTime[addr][u] * addresses[addr].numPass;
+				saving += stopAdjTime[v][i] * addresses[addr].numPass;
+				saving -= walks.adjTime(addr, j) * addresses[addr].numPass;
 			}		
 		}
 	}
@@ -261,15 +254,21 @@ void calcSavingWhenRemovingAStop(SOL &S, int v, double &saving, bool doRepair, b
 	deletingStop = true;
 }
 
-void removeStop(int v, SOL &S, double saving, bool doRepair) {
+void removeStop(SolverContext &ctx, int v, SOL &S, double saving, bool doRepair) {
 	//Remove the non-compulsory used stop v and reassign affected passengers to other stops.
+	const vector<ADDR> &addresses = ctx.inst->addresses;
+	const WALKS &walks = ctx.inst->walks;
+	const vector<vector<int> > &stopAdjList = ctx.inst->stopAdjList;
+	const vector<vector<double> > &stopAdjTime = ctx.inst->stopAdjTime;
+	vector<int> &tVec = ctx.tVec;
+	vector<int> &stopsToPack = ctx.stopsToPack, &weightOfStopsToPack = ctx.weightOfStopsToPack;
 	int i, j, r, c, addr, u, k = S.items.size(), min, x, y;
 	//First remove passengers from stop v in the solution
 	S.stopUsed[v] = false;
 	S.numBoarding[v] = 0;
 	for (i = 0; i < S.routeOfStop[v].size(); i++) {
 		r = S.routeOfStop[v][i];
-		c = S.posInRoute[v][r];
+		c = S.posInRoute.get(v, r);
 		S.passInRoute[r] -= S.W[r][c];
 		S.W[r][c] = 0;
 	}
@@ -277,15 +276,15 @@ void removeStop(int v, SOL &S, double saving, bool doRepair) {
 	for (i = 0; i < stopAdjList[v].size(); i++) {
 		addr = stopAdjList[v][i];
 		if (S.assignedTo[addr] == v) {
-			for (j = 0; j < addrAdjList[addr].size(); j++) {
-				u = addrAdjList[addr][j];
+			for (j = 0; j < walks.numAdj(addr); j++) {
+				u = walks.adjStop(addr, j);
 				if (S.stopUsed[u] && u != v) break;	//Addr can be assigned to a stop u != v that is currently being used 
 			}
-			if (j >= addrAdjList[addr].size()) {
+			if (j >= walks.numAdj(addr)) {
 				//No used stop is suitable for addr, so we assign addr to the closest unused stop u != v instead
 				if (!doRepair) { cout << "Should not be here\n"; exit(1); }
-				u = addrAdjList[addr][0];
-				if (u == v) u = addrAdjList[addr][1];
+				u = walks.adjStop(addr, 0);
+				if (u == v) u = walks.adjStop(addr, 1);
 				S.stopUsed[u] = true;
 				S.assignedTo[addr] = u;
 				S.numBoarding[u] = addresses[addr].numPass;
@@ -303,13 +302,13 @@ void removeStop(int v, SOL &S, double saving, bool doRepair) {
 				S.W[r].push_back(addresses[addr].numPass);
 				S.passInRoute[r] += addresses[addr].numPass;
 				S.routeOfStop[u].push_back(r);
-				S.posInRoute[u][r] = S.items[r].size() - 1;
+				S.posInRoute.set(u, r, S.items[r].size() - 1);
 				//We now need to check if the addition of u affects the walking distances from any other adjacent addresses
 				for (j = 0; j < stopAdjList[u].size(); j++) {
 					//Check if address x, which is currently assigned to stop y, is actually closer to stop u
 					x = stopAdjList[u][j];
 					y = S.assignedTo[x];
-					if (x != addr && y != v && wTime[x][u] < wTime[x][y]) {
+					if (x != addr && y != v && stopAdjTime[u][j] < walks.timeTo(x, y)) {
 						//Add passengers of address x to stop u
 						S.assignedTo[x] = u;
 						S.numBoarding[u] += addresses[x].numPass;
@@ -331,7 +330,7 @@ void removeStop(int v, SOL &S, double saving, bool doRepair) {
 						r = S.routeOfStop[u][j];
 					}
 				}
-				c = S.posInRoute[u][r];
+				c = S.posInRoute.get(u, r);
 				S.W[r][c] += addresses[addr].numPass;
 				S.passInRoute[r] += addresses[addr].numPass;
 				S.assignedTo[addr] = u;
@@ -342,7 +341,7 @@ void removeStop(int v, SOL &S, double saving, bool doRepair) {
 	//Now delete all instances of where S.W = 0. This may mean that some stops that were previously being used may now not be.
 	//tVec keeps track of how many instatnces of each stop are deleted. If all of them are, the stop is no longer used
 	tVec.clear();
-	tVec.resize(stops.size(), 0); 
+	tVec.resize(ctx.inst->stops.size(), 0); 
 	for (i = 0; i < S.W.size(); i++) {
 		j = 0;
 		while (j < S.W[i].size()) {
@@ -364,8 +363,8 @@ void removeStop(int v, SOL &S, double saving, bool doRepair) {
 	stopsToPack.clear();
 	weightOfStopsToPack.clear();
 	for (i = 0; i < k; i++) {
-		while (S.passInRoute[i] > maxBusCapacity) {
-			j = rand() % (S.items[i].size());
+		while (S.passInRoute[i] > ctx.maxBusCapacity) {
+			j = ctx.randInt(S.items[i].size());
 			stopsToPack.push_back(S.items[i][j]);
 			weightOfStopsToPack.push_back(S.W[i][j]);
 			S.passInRoute[i] -= S.W[i][j];
@@ -374,19 +373,94 @@ void removeStop(int v, SOL &S, double saving, bool doRepair) {
 		}
 	}
 	//Use BPP style procedure to pack all the children on to k buses.
-	binPacker(S.items, S.W, S.passInRoute, stopsToPack, weightOfStopsToPack);
+	binPacker(ctx, S.items, S.W, S.passInRoute, stopsToPack, weightOfStopsToPack);
 
 	//Finally, we need to repopulate the residual structures. 
-	repopulateAuxiliaries(S);
+	repopulateAuxiliaries(ctx, S);
 
 	//...and calculate the costs
-	S.cost = calcSolCostFromScratch(S);
+	S.cost = calcSolCostFromScratch(ctx, S);
 	S.costWalk = S.costWalk - saving;
 }
 
-void doMultiObjOptimisation(list <SOL> &A) {
+struct EXPANDSCRATCH {
+	//Kept from one call of expandInParallel() to the next, so that the solutions copied into it can reuse the memory they
+	//already have, and the worker contexts keep their scratch buffers
+	vector<SOL> SPrime;
+	vector<SOL> workerS;
+	vector<SolverContext> workerCtx;
+};
+
+void setUpWorkerContext(SolverContext &wctx, const SolverContext &ctx) {
+	//Makes wctx a context for a worker thread of expandInParallel(). Only the run parameters are taken from ctx; the
+	//scratch buffers of wctx are kept as they are (nothing in them carries over from one local search to the next).
+	//Each task reseeds wctx.rng before using it
+	static_cast<RUNPARAMS &>(wctx) = ctx;
+	wctx.pool = NULL;
+	wctx.lsPool = NULL;
+	clearEvalCounts(wctx);
+}
+
+void expandInParallel(SolverContext &ctx, SOL &S, list<SOL> &A, list<bool> &visited, EXPANDSCRATCH &scratch) {
+	//Parallel version of the loop in doMultiObjOptimisation() that adds or removes each stop v of S in turn. The
+	//neighbouring solutions are formed and optimised as separate tasks on ctx.pool, and are then offered to the archive
+	//in order of v. Each task seeds its own random number generator from v, so the result does not depend on the number
+	//of threads or on the order in which the tasks are run.
+	const vector<STOP> &stops = ctx.inst->stops;
+	int v, n = stops.size(), numWorkers = ctx.pool->size();
+	unsigned int baseSeed = ctx.rng();
+	vector<SOL> &SPrime = scratch.SPrime;
+	vector<char> made(n, 0);
+	//Each worker has its own context and its own copy of S (calcSavingWhenRemovingAStop() changes S temporarily)
+	vector<SolverContext> &workerCtx = scratch.workerCtx;
+	vector<SOL> &workerS = scratch.workerS;
+	vector<char> hasS(numWorkers, 0);
+	SPrime.resize(n);
+	workerS.resize(numWorkers);
+	workerCtx.resize(numWorkers);
+	for (int w = 0; w < numWorkers; w++) setUpWorkerContext(workerCtx[w], ctx);
+	ctx.pool->parallelFor(n - 1, [&](int task, int w) {
+		int v = task + 1, numMoves;
+		double saving, feasRatio;
+		bool addingStop, deletingStop;
+		SolverContext &wctx = workerCtx[w];
+		if (!hasS[w]) {
+			workerS[w] = S;
+			hasS[w] = 1;
+		}
+		wctx.rng.seed(baseSeed + 2654435761u * (unsigned int)v);
+		if (!S.stopUsed[v]) {
+			//Explore consequences of adding the currently unusued stop v
+			calcSavingWhenAddingAStop(wctx, S, v, saving, addingStop);
+			if (addingStop) {
+				SPrime[v] = S;
+				addStop(wctx, v, SPrime[v], saving);
+				localSearch(wctx, SPrime[v], feasRatio, numMoves);
+				made[v] = 1;
+			}
+		}
+		else if (!stops[v].required) {
+			//Explore consequences of removing stop the currently used, non-compulsory stop v
+			calcSavingWhenRemovingAStop(wctx, workerS[w], v, saving, true, deletingStop);
+			if (deletingStop) {
+				SPrime[v] = S;
+				removeStop(wctx, v, SPrime[v], saving, true);
+				localSearch(wctx, SPrime[v], feasRatio, numMoves);
+				made[v] = 1;
+			}
+		}
+	});
+	for (int w = 0; w < numWorkers; w++) addEvalCounts(ctx, workerCtx[w]);
+	//Now merge the new solutions into the archive
+	for (v = 1; v < n; v++) {
+		if (made[v]) updateA(ctx, A, visited, SPrime[v]);
+	}
+}
+
+void doMultiObjOptimisation(SolverContext &ctx, list <SOL> &A) {
 	
 	//This takes an archive of solution(s) and runs the mobj process
+	const vector<STOP> &stops = ctx.inst->stops;
 	list<bool> visited;
 	list<bool>::iterator vIt;
 	list<SOL>::iterator AIt;
@@ -394,49 +468,55 @@ void doMultiObjOptimisation(list <SOL> &A) {
 	double saving, feasRatio;
 	bool addingStop, deletingStop;
 	SOL S, SPrime;
+	EXPANDSCRATCH scratch;
 	
 	//Mark the initial solution in the archive as unvisited
 	visited.push_back(false);
 
 	//Also add the solution where all students are given the shortest possible walk
-	makeInitSol(S, k, 3);
-	localSearch(S, feasRatio, numMoves);
-	updateA(A, visited, S);
+	makeInitSol(ctx, S, k, 3);
+	localSearch(ctx, S, feasRatio, numMoves);
+	updateA(ctx, A, visited, S);
 		
-	if (verbosity >= 1) 
+	if (ctx.verbosity >= 1) 
 		cout << "\n\nNow using multiobjective techiniques to produce a range of solutions that use " << k << " buses.\n\n";
 	
 	while (true) {
 
 		//Select a non-visited member S of the archive. If all are visited, end the algorithm.
-		if (verbosity >= 1) {
+		if (ctx.verbosity >= 1) {
 			printDetails(A, visited, its);
 		}
-		if (chooseUnvisitedSolution(A, visited, S) == false) {
+		if (chooseUnvisitedSolution(ctx, A, visited, S) == false) {
 			break;
 		}
 					
 		//If we are here, S is now a solution we will be visiting from (and has therefore been marked as visited)
+		if (ctx.pool != NULL) {
+			expandInParallel(ctx, S, A, visited, scratch);
+			its++;
+			continue;
+		}
 		for (v = 1; v < stops.size(); v++) {
 			if (!S.stopUsed[v]) {
 				//Explore consequences of adding the currently unusued stop v
-				calcSavingWhenAddingAStop(S, v, saving, addingStop);
+				calcSavingWhenAddingAStop(ctx, S, v, saving, addingStop);
 				if (addingStop) {
 					SPrime = S;
-					addStop(v, SPrime, saving);
-					localSearch(SPrime, feasRatio, numMoves);
-					updateA(A, visited, SPrime);
+					addStop(ctx, v, SPrime, saving);
+					localSearch(ctx, SPrime, feasRatio, numMoves);
+					updateA(ctx, A, visited, SPrime);
 				}
 			}
 			else {
 				if (!stops[v].required) {
 					//Explore consequences of removing stop the currently used, non-compulsory stop v
-					calcSavingWhenRemovingAStop(S, v, saving, true, deletingStop);
+					calcSavingWhenRemovingAStop(ctx, S, v, saving, true, deletingStop);
 					if (deletingStop) {
 						SPrime = S;
-						removeStop(v, SPrime, saving, true);
-						localSearch(SPrime, feasRatio, numMoves);
-						updateA(A, visited, SPrime);
+						removeStop(ctx, v, SPrime, saving, true);
+						localSearch(ctx, SPrime, feasRatio, numMoves);
+						updateA(ctx, A, visited, SPrime);
 					}
 				}
 			}
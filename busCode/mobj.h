@@ -3,6 +3,6 @@
 
 #include "main.h"
 
-void doMultiObjOptimisation(list<SOL> &A);
+void doMultiObjOptimisation(SolverContext &ctx, list<SOL> &A);
 
 #endif //MOBJ_H
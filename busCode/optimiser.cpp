@@ -1,29 +1,7 @@
 #include "optimiser.h"
 #include "fns.h"
 #include "setcover.h"
-
-extern vector<STOP> stops;
-extern vector<ADDR> addresses;
-extern vector<bool> isOutlier;
-extern vector<vector<double> > dDist;
-extern vector<vector<double> > dTime;
-extern vector<vector<double> > wDist;
-extern vector<vector<double> > wTime;
-extern vector<vector<int> > stopAdjList;
-extern vector<vector<int> > addrAdjList;
-extern vector<vector<bool> > addrStopAdj;
-extern int totalPassengers, maxBusCapacity;
-extern double maxWalkDist;
-extern double minEligibilityDist;
-extern string distUnits;
-extern double dwellPerPassenger;
-extern double dwellPerStop;
-extern double excessWeight;
-extern double maxJourneyTime;
-extern int verbosity;
-
-//A "local" global variable for 
-vector<int> tempVec1, tempVec2, tempVec3, tempVec4;
+#include "insertscan.h"
 
 inline
 void swapVals(int &a, int &b) {
@@ -40,7 +18,7 @@ int minVal(int a, int b) {
 	if (a < b) return a; else return b;
 }
 
-void twoOpt(vector<int> &S, int a, int b) {
+void twoOpt(RaggedArray<int>::Row S, int a, int b) {
 	//Does a Two-Opt move
 	int i = a, j = b;
 	if (i > j) swapVals(i, j);
@@ -51,12 +29,17 @@ void twoOpt(vector<int> &S, int a, int b) {
 	}
 }
 
-void updateSol(SOL &S, int r) {
-	//Updates various data structures in the solution after changes have been made to S.items and S.W
-	int passengers = 0, i;
+void updateSol(const SolverContext &ctx, SOL &S, int r, int from = 0) {
+	//Updates various data structures in the solution after changes have been made to S.items and S.W. Only positions from
+	//onwards may have changed; the prefix sums and position indices of earlier stops are left as they are
+	const double maxJourneyTime = ctx.maxJourneyTime;
+	int i;
+	//Update the route's prefix sums. Its length and number of passengers can then be read off their ends
+	calcRoutePrefixes(ctx, S, r, from);
+	S.passInRoute[r] = S.passPre[r].back();
 	//Calculate the cost of the new route and keep track on the number of "feasible routes" in S
-	bool routeHasOutlier = containsOutlierStop(S.items[r]);
-	double newLen = calcRouteLenFromScratch(S, r);
+	bool routeHasOutlier = containsOutlierStop(ctx, S.items[r]);
+	double newLen = calcRouteLenFromPrefixes(ctx, S, r);
 	if (routeHasOutlier == true && S.hasOutlier[r] == false) S.numRoutesWithOutliers++;
 	else if (routeHasOutlier == false && S.hasOutlier[r] == true) S.numRoutesWithOutliers--;
 
@@ -67,23 +50,23 @@ void updateSol(SOL &S, int r) {
 
 	S.hasOutlier[r] = routeHasOutlier;
 	S.routeLen[r] = newLen;
-	//Updatethe number of passengers in this route
-	for (i = 0; i < S.W[r].size(); i++) 
-		passengers += S.W[r][i];
-	S.passInRoute[r] = passengers;
-	//Update the posInRoute array
-	for (i = 0; i < S.items[r].size(); i++) {
-		S.posInRoute[S.items[r][i]][r] = i;
+	//Update the posInRoute array and the route's stop set
+	for (i = from; i < S.items[r].size(); i++) {
+		S.posInRoute.set(S.items[r][i], r, i);
+		S.routeStops.set(r, S.items[r][i], true);
 	}
 }
 
-void resetPosInRoute(SOL &S, int r) {
-	//Used when a route r is about to be changed. Here, all non -1 values in column r are switched to -1s
+void resetPosInRoute(SOL &S, int r, int from = 0) {
+	//Used when a route r is about to be changed from position from onwards. The stops in these positions are removed
+	//from posInRoute and from the route's stop set; updateSol(ctx, S, r, from) puts back the ones still in the route
 	int i;
-	for (i = 0; i < S.items[r].size(); i++) S.posInRoute[S.items[r][i]][r] = -1;
+	for (i = from; i < S.items[r].size(); i++) S.posInRoute.erase(S.items[r][i], r);
+	if (from == 0) S.routeStops.clearRow(r);
+	else for (i = from; i < S.items[r].size(); i++) S.routeStops.set(r, S.items[r][i], false);
 }
 
-void removeElement(int x, vector<int> &A) {
+void removeElement(int x, RaggedArray<int>::Row A) {
 	//Remove an element x from a vector A. (We assume there is exatly one occurence of x)
 	int i;
 	for (i = 0; i < A.size(); i++) if (A[i] == x) break;
@@ -102,36 +85,33 @@ void updateRouteOfStops(SOL &S, int x, int y1, int y2, int i, int j1, int j2) {
 }
 
 void updateCommonStopMatrix(SOL &S, int r) {
-	//Updates the common stops matrix based on the move that has just been made 
+	//Updates the common stops matrix based on the move that has just been made. Uses the routes' stop sets, so is called
+	//after updateSol()
 	int i;
 	for (i = 0; i < S.items.size(); i++) {
 		if (i != r) {
-			if (existsCommonStop(S, r, i)) {
-				S.commonStop[i][r] = true;
-				S.commonStop[r][i] = true;
-			}
-			else {
-				S.commonStop[i][r] = false;
-				S.commonStop[r][i] = false;
-			}
+			bool common = S.routeStops.rowsIntersect(r, i);
+			S.commonStop.set(i, r, common);
+			S.commonStop.set(r, i, common);
 		}
 	}
 }
 
-int checkForPresence(SOL &S, int item, int r) {
+int checkForPresence(const SOL &S, int item, int r) {
 	//Checks if "item" occurs in route r. If so its position is returned, else -1 is returned
-	return (S.posInRoute[item][r]);
+	return (S.posInRoute.get(item, r));
 }
 
-int checkForPresence(SOL &S, int item, int r, int a, int b) {
+int checkForPresence(const SOL &S, int item, int r, int a, int b) {
 	//Checks if "item" occurs in positions [(0,...,(a - 1)] or [b,...,(n - 1)] of route r. If so its position is returned, else -1 is returned
-	int pos = S.posInRoute[item][r];
+	int pos = S.posInRoute.get(item, r);
 	if (pos == -1 || (pos >= a && pos < b)) return -1;
 	else return pos;
 }
 
-void insertSection(SOL &S, int x, int y1, int y2, int i, int j1) {
+void insertSection(SolverContext &ctx, SOL &S, int x, int y1, int y2, int i, int j1) {
 	//Inserts section from route x into route i and eliminates duplicates
+	vector<int> &tempVec1 = ctx.tempVec1, &tempVec2 = ctx.tempVec2;
 	int y, pos;
 	tempVec1.clear();
 	tempVec2.clear();
@@ -163,8 +143,9 @@ void insertSection(SOL &S, int x, int y1, int y2, int i, int j1) {
 	S.W[x].erase(S.W[x].begin() + y1, S.W[x].begin() + y2);
 }
 
-void swapSections(SOL &S, int x, int y1, int y2, int i, int j1, int j2) {
+void swapSections(SolverContext &ctx, SOL &S, int x, int y1, int y2, int i, int j1, int j2) {
 	//Swaps sections from route x and route i and eliminates duplicates
+	vector<int> &tempVec1 = ctx.tempVec1, &tempVec2 = ctx.tempVec2, &tempVec3 = ctx.tempVec3, &tempVec4 = ctx.tempVec4;
 	int y, j, pos;
 	tempVec1.clear();
 	tempVec2.clear();
@@ -210,49 +191,49 @@ void swapSections(SOL &S, int x, int y1, int y2, int i, int j1, int j2) {
 	for (j = 0; j < tempVec3.size(); j++) S.routeOfStop[tempVec3[j]].push_back(x);
 
 	//Reform route i
-	S.items[i].erase(S.items[i].begin() + j1, S.items[i].begin() + j2);
-	S.items[i].insert(S.items[i].begin() + j1, tempVec1.begin(), tempVec1.end());
-	S.W[i].erase(S.W[i].begin() + j1, S.W[i].begin() + j2);
-	S.W[i].insert(S.W[i].begin() + j1, tempVec2.begin(), tempVec2.end());
-	//Reform route x	
-	S.items[x].erase(S.items[x].begin() + y1, S.items[x].begin() + y2);
-	S.items[x].insert(S.items[x].begin() + y1, tempVec3.begin(), tempVec3.end());
-	S.W[x].erase(S.W[x].begin() + y1, S.W[x].begin() + y2);
-	S.W[x].insert(S.W[x].begin() + y1, tempVec4.begin(), tempVec4.end());
+	S.items[i].replace(S.items[i].begin() + j1, S.items[i].begin() + j2, tempVec1.begin(), tempVec1.end());
+	S.W[i].replace(S.W[i].begin() + j1, S.W[i].begin() + j2, tempVec2.begin(), tempVec2.end());
+	//Reform route x
+	S.items[x].replace(S.items[x].begin() + y1, S.items[x].begin() + y2, tempVec3.begin(), tempVec3.end());
+	S.W[x].replace(S.W[x].begin() + y1, S.W[x].begin() + y2, tempVec4.begin(), tempVec4.end());
 }
 
-void doMove1(SOL &S, int x, int y1, int y2, int i, double newCost, bool flippedx) {
+void doMove1(const SolverContext &ctx, SOL &S, int x, int y1, int y2, int i, double newCost, bool flippedx) {
 	//Insert a section from x into the empty route i
 	if (flippedx) {
 		twoOpt(S.items[x], y1, y2 - 1);
 		twoOpt(S.W[x], y1, y2 - 1);
 	}
 	resetPosInRoute(S, i);
-	resetPosInRoute(S, x);
+	resetPosInRoute(S, x, y1);
 	updateRouteOfStops(S, x, y1, y2, i, 0, 0);
 	if (!(y1 == 0 && y2 == S.items[x].size())) S.numEmptyRoutes--;
 	S.items[i].insert(S.items[i].begin(), S.items[x].begin() + y1, S.items[x].begin() + y2);
 	S.items[x].erase(S.items[x].begin() + y1, S.items[x].begin() + y2);
 	S.W[i].insert(S.W[i].begin(), S.W[x].begin() + y1, S.W[x].begin() + y2);
 	S.W[x].erase(S.W[x].begin() + y1, S.W[x].begin() + y2);
+	updateSol(ctx, S, x, y1);
+	updateSol(ctx, S, i);
 	updateCommonStopMatrix(S, x);
 	updateCommonStopMatrix(S, i);
-	updateSol(S, x);
-	updateSol(S, i);
 	S.cost = newCost;
 }
 
-void doMove2(SOL &S, int x, int y1, int y2, int i, int j1, double newCost, bool flippedx) {
+void doMove2(SolverContext &ctx, SOL &S, int x, int y1, int y2, int i, int j1, double newCost, bool flippedx) {
 	//Insert a section from route x into the non-empty route i
 	if (y1 == 0 && y2 == S.items[x].size()) S.numEmptyRoutes++;
 	if (flippedx) {
 		twoOpt(S.items[x], y1, y2 - 1);
 		twoOpt(S.W[x], y1, y2 - 1);
 	}
-	if (S.commonStop[x][i] == false) {
+	//Positions before fromX in route x and before fromI in route i are left unchanged by the move
+	int fromX = 0, fromI = 0;
+	if (S.commonStop(x, i) == false) {
 		//No common stops in routes i and x so can make the changes very simply
-		resetPosInRoute(S, i);
-		resetPosInRoute(S, x);
+		fromX = y1;
+		fromI = j1;
+		resetPosInRoute(S, i, fromI);
+		resetPosInRoute(S, x, fromX);
 		updateRouteOfStops(S, x, y1, y2, i, 0, 0);
 		S.items[i].insert(S.items[i].begin() + j1, S.items[x].begin() + y1, S.items[x].begin() + y2);
 		S.items[x].erase(S.items[x].begin() + y1, S.items[x].begin() + y2);
@@ -261,17 +242,18 @@ void doMove2(SOL &S, int x, int y1, int y2, int i, int j1, double newCost, bool
 	}
 	else {
 		//Routes x and i contain common stops so we need to take care to delete these if they end up in the same route
-		insertSection(S, x, y1, y2, i, j1);
+		insertSection(ctx, S, x, y1, y2, i, j1);
 	}
+	updateSol(ctx, S, x, fromX);
+	updateSol(ctx, S, i, fromI);
 	updateCommonStopMatrix(S, x);
 	updateCommonStopMatrix(S, i);
-	updateSol(S, x);
-	updateSol(S, i);
 	S.cost = newCost;
 }
 
-void doMove3(SOL &S, int x, int y1, int y2, int i, int j1, int j2, double newCost, bool flippedx, bool flippedi) {
+void doMove3(SolverContext &ctx, SOL &S, int x, int y1, int y2, int i, int j1, int j2, double newCost, bool flippedx, bool flippedi) {
 	//Swap a section from route x and a section from route i
+	vector<int> &tempVec1 = ctx.tempVec1;
 	if (flippedx) {
 		twoOpt(S.items[x], y1, y2 - 1);
 		twoOpt(S.W[x], y1, y2 - 1);
@@ -280,95 +262,84 @@ void doMove3(SOL &S, int x, int y1, int y2, int i, int j1, int j2, double newCos
 		twoOpt(S.items[i], j1, j2 - 1);
 		twoOpt(S.W[i], j1, j2 - 1);
 	}
-	if (S.commonStop[x][i] == false) {
+	int fromX = 0, fromI = 0;
+	if (S.commonStop(x, i) == false) {
 		//No common stops in routes i and x so can make the changes very simply
-		resetPosInRoute(S, i);
-		resetPosInRoute(S, x);
+		fromX = y1;
+		fromI = j1;
+		resetPosInRoute(S, i, fromI);
+		resetPosInRoute(S, x, fromX);
 		updateRouteOfStops(S, x, y1, y2, i, j1, j2);
-		tempVec1.clear();
+		//Each route's tail moves once, by the difference in the sections' lengths
 		tempVec1.assign(S.items[i].begin() + j1, S.items[i].begin() + j2);
-		S.items[i].erase(S.items[i].begin() + j1, S.items[i].begin() + j2);
-		S.items[i].insert(S.items[i].begin() + j1, S.items[x].begin() + y1, S.items[x].begin() + y2);
-		S.items[x].erase(S.items[x].begin() + y1, S.items[x].begin() + y2);
-		S.items[x].insert(S.items[x].begin() + y1, tempVec1.begin(), tempVec1.end());
-		tempVec1.clear();
+		S.items[i].replace(S.items[i].begin() + j1, S.items[i].begin() + j2, S.items[x].begin() + y1, S.items[x].begin() + y2);
+		S.items[x].replace(S.items[x].begin() + y1, S.items[x].begin() + y2, tempVec1.begin(), tempVec1.end());
 		tempVec1.assign(S.W[i].begin() + j1, S.W[i].begin() + j2);
-		S.W[i].erase(S.W[i].begin() + j1, S.W[i].begin() + j2);
-		S.W[i].insert(S.W[i].begin() + j1, S.W[x].begin() + y1, S.W[x].begin() + y2);
-		S.W[x].erase(S.W[x].begin() + y1, S.W[x].begin() + y2);
-		S.W[x].insert(S.W[x].begin() + y1, tempVec1.begin(), tempVec1.end());
+		S.W[i].replace(S.W[i].begin() + j1, S.W[i].begin() + j2, S.W[x].begin() + y1, S.W[x].begin() + y2);
+		S.W[x].replace(S.W[x].begin() + y1, S.W[x].begin() + y2, tempVec1.begin(), tempVec1.end());
 	}
 	else {
 		//Routes i and x contain common stops so we need to take care to delete these if they end up in the same route
-		swapSections(S, x, y1, y2, i, j1, j2);
+		swapSections(ctx, S, x, y1, y2, i, j1, j2);
 	}
 	if (S.items[x].empty()) S.numEmptyRoutes++;
 	if (S.items[i].empty()) S.numEmptyRoutes++;
+	updateSol(ctx, S, x, fromX);
+	updateSol(ctx, S, i, fromI);
 	updateCommonStopMatrix(S, x);
 	updateCommonStopMatrix(S, i);
-	updateSol(S, x);
-	updateSol(S, i);
 	S.cost = newCost;
 }
 
-void doMove4(SOL &S, int x, int y1, int y2, double newCost){
+void doMove4(const SolverContext &ctx, SOL &S, int x, int y1, int y2, double newCost){
 	//Swap two stops in a route x
-	resetPosInRoute(S, x);
+	int from = minVal(y1, y2);
+	resetPosInRoute(S, x, from);
 	swapVals(S.items[x][y1], S.items[x][y2]);
 	swapVals(S.W[x][y1], S.W[x][y2]);
-	updateSol(S, x);
+	updateSol(ctx, S, x, from);
 	S.cost = newCost;
 }
 
-void doMove5(SOL &S, int x, int y1, int y2, double newCost){
+void doMove5(const SolverContext &ctx, SOL &S, int x, int y1, int y2, double newCost){
 	//Do a two-opt in a single route x
-	resetPosInRoute(S, x);
+	int from = minVal(y1, y2);
+	resetPosInRoute(S, x, from);
 	twoOpt(S.items[x], y1, y2);
 	twoOpt(S.W[x], y1, y2);
-	updateSol(S, x);
+	updateSol(ctx, S, x, from);
 	S.cost = newCost;
 }
 
-void doMove6(SOL &S, int x, int y1, int y2, int z, double newCost, bool flippedx) {
+void doMove6(SolverContext &ctx, SOL &S, int x, int y1, int y2, int z, double newCost, bool flippedx) {
 	//So an Or-opt on a single route x
 	if (flippedx) {
 		twoOpt(S.items[x], y1, y2);
 		twoOpt(S.W[x], y1, y2);
 	}
-	resetPosInRoute(S, x);
-	tempVec1.clear();
-	tempVec1.assign(S.items[x].begin() + y1, S.items[x].begin() + (y2 + 1));
-	S.items[x].erase(S.items[x].begin() + y1, S.items[x].begin() + (y2 + 1));
-	if (y1 > z)		S.items[x].insert(S.items[x].begin() + z, tempVec1.begin(), tempVec1.end());
-	else			S.items[x].insert(S.items[x].begin() + (z - tempVec1.size()), tempVec1.begin(), tempVec1.end());
-	tempVec1.clear();
-	tempVec1.assign(S.W[x].begin() + y1, S.W[x].begin() + (y2 + 1));
-	S.W[x].erase(S.W[x].begin() + y1, S.W[x].begin() + (y2 + 1));
-	if (y1 > z)		S.W[x].insert(S.W[x].begin() + z, tempVec1.begin(), tempVec1.end());
-	else			S.W[x].insert(S.W[x].begin() + (z - tempVec1.size()), tempVec1.begin(), tempVec1.end());
-	updateSol(S, x);
+	int from = minVal(y1, z);
+	resetPosInRoute(S, x, from);
+	//Rotate the section into place. Only the stops between the section and z move
+	if (y1 > z) {
+		rotate(S.items[x].begin() + z, S.items[x].begin() + y1, S.items[x].begin() + (y2 + 1));
+		rotate(S.W[x].begin() + z, S.W[x].begin() + y1, S.W[x].begin() + (y2 + 1));
+	}
+	else {
+		rotate(S.items[x].begin() + y1, S.items[x].begin() + (y2 + 1), S.items[x].begin() + z);
+		rotate(S.W[x].begin() + y1, S.W[x].begin() + (y2 + 1), S.W[x].begin() + z);
+	}
+	updateSol(ctx, S, x, from);
 	S.cost = newCost;
 }
 
-void doMove7(SOL &S, int x, int i, int j, double newCost) {
-	int u, v = S.items[i][j], pos = S.posInRoute[v][x], bestInsertPos = -1, spareCapX = maxBusCapacity - S.passInRoute[x], toTransfer;
-	double minCost, inserCost;
+void doMove7(SolverContext &ctx, SOL &S, int x, int i, int j, double newCost) {
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
+	const int maxBusCapacity = ctx.maxBusCapacity;
+	const double maxJourneyTime = ctx.maxJourneyTime;
+	int v = S.items[i][j], pos = S.posInRoute.get(v, x), bestInsertPos = -1, spareCapX = maxBusCapacity - S.passInRoute[x], toTransfer;
 	if (pos == -1 && S.items[x].size() > 0) {
 		//Stop v is not in nonempty route x, so we ID the best point to insert it (before stop "bestInsertPos")
-		minCost = dTime[v][S.items[x][0]];
-		bestInsertPos = 0;
-		for (u = 1; u < S.items[x].size(); u++) {
-			inserCost = dTime[S.items[x][u - 1]][v] + dTime[v][S.items[x][u]] - dTime[S.items[x][u - 1]][S.items[x][u]];
-			if(inserCost < minCost){
-				minCost = inserCost;
-				bestInsertPos = u;
-			}
-		}
-		inserCost = dTime[S.items[x].back()][v] + dTime[v][0] - dTime[S.items[x].back()][0];
-		if (inserCost < minCost) {
-			minCost = inserCost;
-			bestInsertPos = S.items[x].size();
-		}
+		bestInsertPos = bestStopInsertPos(dTime, S.items[x], v, ctx.ls.insCost, ctx.useSIMD);
 	}
 	//Now calculate how many passengers we will transfer from v in route i, to v in route j
 	if (S.routeLen[i] < maxJourneyTime) toTransfer = 1;
@@ -378,8 +349,8 @@ void doMove7(SOL &S, int x, int i, int j, double newCost) {
 		//We are just transferring passengers between existing multistops
 		S.W[i][j] -= toTransfer;
 		S.W[x][pos] += toTransfer;
-		updateSol(S, i);
-		updateSol(S, x);
+		updateSol(ctx, S, i, j);
+		updateSol(ctx, S, x, pos);
 		S.cost = newCost;
 	}
 	else if (S.items[x].empty()) {
@@ -388,10 +359,10 @@ void doMove7(SOL &S, int x, int i, int j, double newCost) {
 		S.items[x].push_back(v);
 		S.W[x].push_back(toTransfer);
 		S.routeOfStop[v].push_back(x);
+		updateSol(ctx, S, i, j);
+		updateSol(ctx, S, x);
 		updateCommonStopMatrix(S, x);
 		updateCommonStopMatrix(S, i);
-		updateSol(S, i);
-		updateSol(S, x);
 		S.cost = newCost;
 		S.numEmptyRoutes--;
 		S.solSize++;
@@ -402,18 +373,99 @@ void doMove7(SOL &S, int x, int i, int j, double newCost) {
 		S.items[x].insert(S.items[x].begin() + bestInsertPos, v);
 		S.W[x].insert(S.W[x].begin() + bestInsertPos, toTransfer);
 		S.routeOfStop[v].push_back(x);
+		updateSol(ctx, S, i, j);
+		updateSol(ctx, S, x, bestInsertPos);
 		updateCommonStopMatrix(S, x);
 		updateCommonStopMatrix(S, i);
-		updateSol(S, i);
-		updateSol(S, x);
 		S.cost = newCost;
 		S.solSize++;
 	}
 }
 
-void evaluateOrOpt(double &newCost, SOL &S, int route, int x, int y, int z, EVALINFO &info)
+inline
+void getSectionX(const SOL &S, int r, int a, int b, EVALINFO &info) {
+	//Reads the totals of section (S[r][a]...S[r][b-1]) into the X fields of info in O(1) using the route's prefix sums
+	if (a == b) {
+		info.innerX = info.innerXF = info.dwellXSection = 0.0;
+		info.passXSection = 0;
+		return;
+	}
+	info.innerX = S.travelPre[r][b - 1] - S.travelPre[r][a];
+	info.innerXF = S.travelPreF[r][b - 1] - S.travelPreF[r][a];
+	info.dwellXSection = S.dwellPre[r][b] - S.dwellPre[r][a];
+	info.passXSection = S.passPre[r][b] - S.passPre[r][a];
+}
+
+inline
+void getSectionI(const SOL &S, int r, int a, int b, EVALINFO &info) {
+	//As getSectionX, but for the I fields of info
+	if (a == b) {
+		info.innerI = info.innerIF = info.dwellISection = 0.0;
+		info.passISection = 0;
+		return;
+	}
+	info.innerI = S.travelPre[r][b - 1] - S.travelPre[r][a];
+	info.innerIF = S.travelPreF[r][b - 1] - S.travelPreF[r][a];
+	info.dwellISection = S.dwellPre[r][b] - S.dwellPre[r][a];
+	info.passISection = S.passPre[r][b] - S.passPre[r][a];
+}
+
+void makeCandidateLists(SolverContext &ctx, FlatMatrix<char> &isCandidate) {
+	//Granular neighbourhoods: for each stop u, marks the ctx.granularity stops closest to u (by driving time) as candidates
+	//of u. The relation is made symmetric, so isCandidate(u, v) is 1 if v is near to u or u is near to v. The matrix
+	//depends only on the instance and the granularity, so it is built once and shared (read-only) by every context
+	//copied from ctx
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
+	int u, v, j, n = ctx.inst->stops.size();
+	vector<int> order;
+	ctx.isCandidate = NULL;
+	if (ctx.granularity <= 0) return;
+	isCandidate.resize(n, n, 0);
+	for (u = 1; u < n; u++) {
+		order.clear();
+		for (v = 1; v < n; v++) if (v != u) order.push_back(v);
+		j = min(ctx.granularity, int(order.size()));
+		partial_sort(order.begin(), order.begin() + j, order.end(), [&](int a, int b) { return dTime(u, a) < dTime(u, b) || (dTime(u, a) == dTime(u, b) && a < b); });
+		while (j-- > 0) {
+			isCandidate(u, order[j]) = 1;
+			isCandidate(order[j], u) = 1;
+		}
+	}
+	ctx.isCandidate = &isCandidate;
+}
+
+inline
+bool joinsCandidates(const SolverContext &ctx, int p, int a, int b) {
+	//True if stop p is a candidate of either end (a or b) of a section placed next to it
+	return (*ctx.isCandidate)(p, a) || (*ctx.isCandidate)(p, b);
+}
+
+bool insertIsGranular(const SolverContext &ctx, const SOL &S, int i, int j1, int x, int y1, int y2) {
+	//Granular neighbourhoods: true if inserting section (S[x][y1]...S[x][y2-1]) before S[i][j1], in either direction,
+	//creates an edge between candidate stops. As usual, a new edge to the school (at the end of the route) always counts
+	int a = S.items[x][y1], b = S.items[x][y2 - 1];
+	if (j1 == S.items[i].size()) return true;
+	if (j1 > 0 && joinsCandidates(ctx, S.items[i][j1 - 1], a, b)) return true;
+	if (j1 < S.items[i].size() && joinsCandidates(ctx, S.items[i][j1], a, b)) return true;
+	return false;
+}
+
+bool swapIsGranular(const SolverContext &ctx, const SOL &S, int i, int j1, int j2, int x, int y1, int y2) {
+	//Granular neighbourhoods: true if swapping sections (S[x][y1]...S[x][y2-1]) and (S[i][j1]...S[i][j2-1]), in either
+	//direction, creates an edge between candidate stops or a new edge to the school
+	int a = S.items[x][y1], b = S.items[x][y2 - 1], c = S.items[i][j1], d = S.items[i][j2 - 1];
+	if (j2 == S.items[i].size() || y2 == S.items[x].size()) return true;
+	if (j1 > 0 && joinsCandidates(ctx, S.items[i][j1 - 1], a, b)) return true;
+	if (j2 < S.items[i].size() && joinsCandidates(ctx, S.items[i][j2], a, b)) return true;
+	if (y1 > 0 && joinsCandidates(ctx, S.items[x][y1 - 1], c, d)) return true;
+	if (y2 < S.items[x].size() && joinsCandidates(ctx, S.items[x][y2], c, d)) return true;
+	return false;
+}
+
+void evaluateOrOpt(const SolverContext &ctx, double &newCost, const SOL &S, int route, int x, int y, int z, EVALINFO &info)
 {
 	//Evaluate the effect of removing sequence (x,....,y) reinserting before pos z
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
 	int n = S.items[route].size();
 	double newLen, newLenF;
 	if (z >= x && z <= y + 1) {
@@ -421,290 +473,269 @@ void evaluateOrOpt(double &newCost, SOL &S, int route, int x, int y, int z, EVAL
 		exit(1);
 	} 
 	else if (x == 0 && z == n) {
-		newLen = S.routeLen[route] - dTime[S.items[route][y]][S.items[route][y + 1]] - dTime[S.items[route][z - 1]][0] + dTime[S.items[route][z - 1]][S.items[route][x]] + dTime[S.items[route][y]][0];
-		newLenF = S.routeLen[route] - dTime[S.items[route][y]][S.items[route][y + 1]] - dTime[S.items[route][z - 1]][0] + dTime[S.items[route][z - 1]][S.items[route][y]] + dTime[S.items[route][x]][0] - info.innerX + info.innerXF;
+		newLen = S.routeLen[route] - dTime(S.items[route][y], S.items[route][y + 1]) - dTime(S.items[route][z - 1], 0) + dTime(S.items[route][z - 1], S.items[route][x]) + dTime(S.items[route][y], 0);
+		newLenF = S.routeLen[route] - dTime(S.items[route][y], S.items[route][y + 1]) - dTime(S.items[route][z - 1], 0) + dTime(S.items[route][z - 1], S.items[route][y]) + dTime(S.items[route][x], 0) - info.innerX + info.innerXF;
 	}
 	else if (x == 0) {
-		newLen = S.routeLen[route] - dTime[S.items[route][y]][S.items[route][y + 1]] - dTime[S.items[route][z - 1]][S.items[route][z]] + dTime[S.items[route][z - 1]][S.items[route][x]] + dTime[S.items[route][y]][S.items[route][z]];
-		newLenF = S.routeLen[route] - dTime[S.items[route][y]][S.items[route][y + 1]] - dTime[S.items[route][z - 1]][S.items[route][z]] + dTime[S.items[route][z - 1]][S.items[route][y]] + dTime[S.items[route][x]][S.items[route][z]] - info.innerX + info.innerXF;
+		newLen = S.routeLen[route] - dTime(S.items[route][y], S.items[route][y + 1]) - dTime(S.items[route][z - 1], S.items[route][z]) + dTime(S.items[route][z - 1], S.items[route][x]) + dTime(S.items[route][y], S.items[route][z]);
+		newLenF = S.routeLen[route] - dTime(S.items[route][y], S.items[route][y + 1]) - dTime(S.items[route][z - 1], S.items[route][z]) + dTime(S.items[route][z - 1], S.items[route][y]) + dTime(S.items[route][x], S.items[route][z]) - info.innerX + info.innerXF;
 	}
 	else if (z == n) {
-		newLen = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][S.items[route][y + 1]] - dTime[S.items[route][z - 1]][0] + dTime[S.items[route][x - 1]][S.items[route][y + 1]] + dTime[S.items[route][z - 1]][S.items[route][x]] + dTime[S.items[route][y]][0];
-		newLenF = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][S.items[route][y + 1]] - dTime[S.items[route][z - 1]][0] + dTime[S.items[route][x - 1]][S.items[route][y + 1]] + dTime[S.items[route][z - 1]][S.items[route][y]] + dTime[S.items[route][x]][0] - info.innerX + info.innerXF;
+		newLen = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], S.items[route][y + 1]) - dTime(S.items[route][z - 1], 0) + dTime(S.items[route][x - 1], S.items[route][y + 1]) + dTime(S.items[route][z - 1], S.items[route][x]) + dTime(S.items[route][y], 0);
+		newLenF = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], S.items[route][y + 1]) - dTime(S.items[route][z - 1], 0) + dTime(S.items[route][x - 1], S.items[route][y + 1]) + dTime(S.items[route][z - 1], S.items[route][y]) + dTime(S.items[route][x], 0) - info.innerX + info.innerXF;
 	}
 	else if (y == n - 1 && z == 0) {
-		newLen = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][0] + dTime[S.items[route][x - 1]][0] + dTime[S.items[route][y]][S.items[route][z]];
-		newLenF = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][0] + dTime[S.items[route][x - 1]][0] + dTime[S.items[route][x]][S.items[route][z]] - info.innerX + info.innerXF;
+		newLen = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], 0) + dTime(S.items[route][x - 1], 0) + dTime(S.items[route][y], S.items[route][z]);
+		newLenF = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], 0) + dTime(S.items[route][x - 1], 0) + dTime(S.items[route][x], S.items[route][z]) - info.innerX + info.innerXF;
 	}
 	else if (y == n - 1) {
-		newLen = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][0] - dTime[S.items[route][z - 1]][S.items[route][z]] + dTime[S.items[route][x - 1]][0] + dTime[S.items[route][z - 1]][S.items[route][x]] + dTime[S.items[route][y]][S.items[route][z]];
-		newLenF = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][0] - dTime[S.items[route][z - 1]][S.items[route][z]] + dTime[S.items[route][x - 1]][0] + dTime[S.items[route][z - 1]][S.items[route][y]] + dTime[S.items[route][x]][S.items[route][z]] - info.innerX + info.innerXF;
+		newLen = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], 0) - dTime(S.items[route][z - 1], S.items[route][z]) + dTime(S.items[route][x - 1], 0) + dTime(S.items[route][z - 1], S.items[route][x]) + dTime(S.items[route][y], S.items[route][z]);
+		newLenF = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], 0) - dTime(S.items[route][z - 1], S.items[route][z]) + dTime(S.items[route][x - 1], 0) + dTime(S.items[route][z - 1], S.items[route][y]) + dTime(S.items[route][x], S.items[route][z]) - info.innerX + info.innerXF;
 	}
 	else if (z == 0) {
-		newLen = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][S.items[route][y + 1]] + dTime[S.items[route][x - 1]][S.items[route][y + 1]] + dTime[S.items[route][y]][S.items[route][z]];
-		newLenF = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][S.items[route][y + 1]] + dTime[S.items[route][x - 1]][S.items[route][y + 1]] + dTime[S.items[route][x]][S.items[route][z]] - info.innerX + info.innerXF;
+		newLen = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], S.items[route][y + 1]) + dTime(S.items[route][x - 1], S.items[route][y + 1]) + dTime(S.items[route][y], S.items[route][z]);
+		newLenF = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], S.items[route][y + 1]) + dTime(S.items[route][x - 1], S.items[route][y + 1]) + dTime(S.items[route][x], S.items[route][z]) - info.innerX + info.innerXF;
 	}
 	else {
-		newLen = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][S.items[route][y + 1]] - dTime[S.items[route][z - 1]][S.items[route][z]] + dTime[S.items[route][z - 1]][S.items[route][x]] + dTime[S.items[route][y]][S.items[route][z]] + dTime[S.items[route][x - 1]][S.items[route][y + 1]];
-		newLenF = S.routeLen[route] - dTime[S.items[route][x - 1]][S.items[route][x]] - dTime[S.items[route][y]][S.items[route][y + 1]] - dTime[S.items[route][z - 1]][S.items[route][z]] + dTime[S.items[route][z - 1]][S.items[route][y]] + dTime[S.items[route][x]][S.items[route][z]] + dTime[S.items[route][x - 1]][S.items[route][y + 1]] - info.innerX + info.innerXF;
+		newLen = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], S.items[route][y + 1]) - dTime(S.items[route][z - 1], S.items[route][z]) + dTime(S.items[route][z - 1], S.items[route][x]) + dTime(S.items[route][y], S.items[route][z]) + dTime(S.items[route][x - 1], S.items[route][y + 1]);
+		newLenF = S.routeLen[route] - dTime(S.items[route][x - 1], S.items[route][x]) - dTime(S.items[route][y], S.items[route][y + 1]) - dTime(S.items[route][z - 1], S.items[route][z]) + dTime(S.items[route][z - 1], S.items[route][y]) + dTime(S.items[route][x], S.items[route][z]) + dTime(S.items[route][x - 1], S.items[route][y + 1]) - info.innerX + info.innerXF;
 	}
 	if (newLen <= newLenF) info.flippedX = false;
 	else info.flippedX = true;
 	newLen = minVal(newLen, newLenF);
-	newCost = S.cost - calcRCost(S.routeLen[route]) + calcRCost(newLen);
+	newCost = S.cost - calcRCost(ctx, S.routeLen[route]) + calcRCost(ctx, newLen);
 }
 	
-void evaluateSwapTwoOpt(double &newCost, SOL &S, int route, int x, int y, int moveType, EVALINFO &info)
+void evaluateSwapTwoOpt(const SolverContext &ctx, double &newCost, const SOL &S, int route, int x, int y, int moveType, EVALINFO &info)
 {
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
 	if (x == y) { newCost = S.cost;	return; }
 	//Given current solution and cost, calculates the new cost according to x <= y and moveType
 	int xl = x - 1, xr = x + 1, yl = y - 1, yr = y + 1, n = S.items[route].size();
 	double newLen;
 	if (moveType == 5 || x == y - 1) {
 		//Evaluating a twoOpt. NB: A two-opt with 2 consecutive locations is the same as a swap
-		if (x == 0 && y == n - 1)	newLen = S.routeLen[route] - dTime[S.items[route][y]][0] + dTime[S.items[route][x]][0] - info.innerX + info.innerXF;
-		else if (x == 0)			newLen = S.routeLen[route] - dTime[S.items[route][y]][S.items[route][yr]] + dTime[S.items[route][x]][S.items[route][yr]] - info.innerX + info.innerXF;
-		else if (y == n - 1)		newLen = S.routeLen[route] - dTime[S.items[route][xl]][S.items[route][x]] - dTime[S.items[route][y]][0] + dTime[S.items[route][xl]][S.items[route][y]] + dTime[S.items[route][x]][0] - info.innerX + info.innerXF;
-		else						newLen = S.routeLen[route] - dTime[S.items[route][xl]][S.items[route][x]] - dTime[S.items[route][y]][S.items[route][yr]] + dTime[S.items[route][xl]][S.items[route][y]] + dTime[S.items[route][x]][S.items[route][yr]] - info.innerX + info.innerXF;
+		if (x == 0 && y == n - 1)	newLen = S.routeLen[route] - dTime(S.items[route][y], 0) + dTime(S.items[route][x], 0) - info.innerX + info.innerXF;
+		else if (x == 0)			newLen = S.routeLen[route] - dTime(S.items[route][y], S.items[route][yr]) + dTime(S.items[route][x], S.items[route][yr]) - info.innerX + info.innerXF;
+		else if (y == n - 1)		newLen = S.routeLen[route] - dTime(S.items[route][xl], S.items[route][x]) - dTime(S.items[route][y], 0) + dTime(S.items[route][xl], S.items[route][y]) + dTime(S.items[route][x], 0) - info.innerX + info.innerXF;
+		else						newLen = S.routeLen[route] - dTime(S.items[route][xl], S.items[route][x]) - dTime(S.items[route][y], S.items[route][yr]) + dTime(S.items[route][xl], S.items[route][y]) + dTime(S.items[route][x], S.items[route][yr]) - info.innerX + info.innerXF;
 	}
 	else {
 		//Evaluating a swap (the swapping of two consecutive elements is covered above)
-		if (x == 0 && y == n - 1)	newLen = S.routeLen[route] - dTime[S.items[route][x]][S.items[route][xr]] - dTime[S.items[route][yl]][S.items[route][y]] - dTime[S.items[route][y]][0] + dTime[S.items[route][y]][S.items[route][xr]] + dTime[S.items[route][yl]][S.items[route][x]] + dTime[S.items[route][x]][0];
-		else if (x == 0)			newLen = S.routeLen[route] - dTime[S.items[route][x]][S.items[route][xr]] - dTime[S.items[route][yl]][S.items[route][y]] - dTime[S.items[route][y]][S.items[route][yr]] + dTime[S.items[route][y]][S.items[route][xr]] + dTime[S.items[route][yl]][S.items[route][x]] + dTime[S.items[route][x]][S.items[route][yr]];
-		else if (y == n - 1)		newLen = S.routeLen[route] - dTime[S.items[route][xl]][S.items[route][x]] - dTime[S.items[route][x]][S.items[route][xr]] - dTime[S.items[route][yl]][S.items[route][y]] - dTime[S.items[route][y]][0] + dTime[S.items[route][xl]][S.items[route][y]] + dTime[S.items[route][y]][S.items[route][xr]] + dTime[S.items[route][yl]][S.items[route][x]] + dTime[S.items[route][x]][0];
-		else						newLen = S.routeLen[route] - dTime[S.items[route][xl]][S.items[route][x]] - dTime[S.items[route][x]][S.items[route][xr]] - dTime[S.items[route][yl]][S.items[route][y]] - dTime[S.items[route][y]][S.items[route][yr]] + dTime[S.items[route][xl]][S.items[route][y]] + dTime[S.items[route][y]][S.items[route][xr]] + dTime[S.items[route][yl]][S.items[route][x]] + dTime[S.items[route][x]][S.items[route][yr]];
+		if (x == 0 && y == n - 1)	newLen = S.routeLen[route] - dTime(S.items[route][x], S.items[route][xr]) - dTime(S.items[route][yl], S.items[route][y]) - dTime(S.items[route][y], 0) + dTime(S.items[route][y], S.items[route][xr]) + dTime(S.items[route][yl], S.items[route][x]) + dTime(S.items[route][x], 0);
+		else if (x == 0)			newLen = S.routeLen[route] - dTime(S.items[route][x], S.items[route][xr]) - dTime(S.items[route][yl], S.items[route][y]) - dTime(S.items[route][y], S.items[route][yr]) + dTime(S.items[route][y], S.items[route][xr]) + dTime(S.items[route][yl], S.items[route][x]) + dTime(S.items[route][x], S.items[route][yr]);
+		else if (y == n - 1)		newLen = S.routeLen[route] - dTime(S.items[route][xl], S.items[route][x]) - dTime(S.items[route][x], S.items[route][xr]) - dTime(S.items[route][yl], S.items[route][y]) - dTime(S.items[route][y], 0) + dTime(S.items[route][xl], S.items[route][y]) + dTime(S.items[route][y], S.items[route][xr]) + dTime(S.items[route][yl], S.items[route][x]) + dTime(S.items[route][x], 0);
+		else						newLen = S.routeLen[route] - dTime(S.items[route][xl], S.items[route][x]) - dTime(S.items[route][x], S.items[route][xr]) - dTime(S.items[route][yl], S.items[route][y]) - dTime(S.items[route][y], S.items[route][yr]) + dTime(S.items[route][xl], S.items[route][y]) + dTime(S.items[route][y], S.items[route][xr]) + dTime(S.items[route][yl], S.items[route][x]) + dTime(S.items[route][x], S.items[route][yr]);
 	}
-	newCost = S.cost - calcRCost(S.routeLen[route]) + calcRCost(newLen);
+	newCost = S.cost - calcRCost(ctx, S.routeLen[route]) + calcRCost(ctx, newLen);
 }
 
-void evaluateInterEmpty(double &newCost, SOL &S, int i, int x, int y1, int y2, EVALINFO &info)
+double calcLenXSecRemoved(const SolverContext &ctx, const SOL &S, int x, int y1, int y2, const EVALINFO &info)
+{
+	//Length of route x once section (S[x][y1]...S[x][y2-1]) is taken out of it
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
+	if (y1 == 0) {
+		if (y2 == S.items[x].size())	return S.routeLen[x] - dTime(S.items[x][y2 - 1], 0) - info.innerX - info.dwellXSection;
+		else							return S.routeLen[x] - dTime(S.items[x][y2 - 1], S.items[x][y2]) - info.innerX - info.dwellXSection;
+	}
+	else if (y2 == S.items[x].size())	return S.routeLen[x] - dTime(S.items[x][y1 - 1], S.items[x][y1]) - dTime(S.items[x][y2 - 1], 0) + dTime(S.items[x][y1 - 1], 0) - info.innerX - info.dwellXSection;
+	else								return S.routeLen[x] - dTime(S.items[x][y1 - 1], S.items[x][y1]) - dTime(S.items[x][y2 - 1], S.items[x][y2]) + dTime(S.items[x][y1 - 1], S.items[x][y2]) - info.innerX - info.dwellXSection;
+}
+
+void evaluateInterEmpty(const SolverContext &ctx, double &newCost, const SOL &S, int i, int x, int y1, int y2, EVALINFO &info)
 {
 	//We are inserting a section from route x into the empty route i. Calculate the result of doing this
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
 	double newLenx, newLeni, newLeniF;
-	newLeni = dTime[S.items[x][y2 - 1]][0] + info.innerX + info.dwellXSection;
-	newLeniF = dTime[S.items[x][y1]][0] + info.innerXF + info.dwellXSection;
+	newLeni = dTime(S.items[x][y2 - 1], 0) + info.innerX + info.dwellXSection;
+	newLeniF = dTime(S.items[x][y1], 0) + info.innerXF + info.dwellXSection;
 	//Determine which is better and proceed with this result
 	if (newLeni <= newLeniF) info.flippedX = false;
 	else info.flippedX = true;
 	newLeni = minVal(newLeni, newLeniF);
 	//Also calculate the result of removing the section from x 
-	if (y1 == 0) {
-		if (y2 == S.items[x].size())		newLenx = S.routeLen[x] - dTime[S.items[x][y2 - 1]][0] - info.innerX - info.dwellXSection;
-		else								newLenx = S.routeLen[x] - dTime[S.items[x][y2 - 1]][S.items[x][y2]] - info.innerX - info.dwellXSection;
+	newLenx = calcLenXSecRemoved(ctx, S, x, y1, y2, info);
+	newCost = S.cost - calcRCost(ctx, S.routeLen[x])	+ calcRCost(ctx, newLenx) + calcRCost(ctx, newLeni);
+}
+
+bool dedupSection(const SolverContext &ctx, const SOL &S, int r, int a, int b, bool flipped, int other, int c, int d,
+	int &front, int &back, double &internal, double &dwellSaving) {
+	//Walks through section (S[r][a]...S[r][b-1]) in the order it would be inserted (backwards if flipped) and skips any
+	//stop that also occurs in route "other" outside positions [c,...,(d - 1)], since such a stop is merged with its
+	//duplicate rather than copied. Gives the first and last stops that remain (-1 if none), the travel time along the
+	//remaining stops, and the dwell time saved. Returns true if any stop was skipped. S is not changed
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
+	int p, step = flipped ? -1 : 1, stop;
+	bool dup = false;
+	front = back = -1;
+	internal = 0.0;
+	dwellSaving = 0.0;
+	for (p = flipped ? b - 1 : a; p >= a && p < b; p += step) {
+		stop = S.items[r][p];
+		if (checkForPresence(S, stop, other, c, d) == -1) {
+			//The stop is not duplicated in route other, so it is kept
+			if (back != -1) internal += dTime(back, stop);
+			else front = stop;
+			back = stop;
+		}
+		else {
+			//The stop is duplicated in route other, so we don't copy it and we record the associated stopping time
+			dwellSaving += calcDwellTime(ctx, 0);
+			dup = true;
+		}
 	}
-	else if (y2 == S.items[x].size())		newLenx = S.routeLen[x] - dTime[S.items[x][y1 - 1]][S.items[x][y1]] - dTime[S.items[x][y2 - 1]][0] + dTime[S.items[x][y1 - 1]][0] - info.innerX - info.dwellXSection;
-	else									newLenx = S.routeLen[x] - dTime[S.items[x][y1 - 1]][S.items[x][y1]] - dTime[S.items[x][y2 - 1]][S.items[x][y2]] + dTime[S.items[x][y1 - 1]][S.items[x][y2]] - info.innerX - info.dwellXSection;
-	newCost = S.cost - calcRCost(S.routeLen[x])	+ calcRCost(newLenx) + calcRCost(newLeni);
+	return dup;
 }
 
-double calcRealInsertCost(SOL &S, int i, int j1, vector<int> &xSection, double internalX, EVALINFO &info) {
-	//We are INSERTING xSection before position S.items[i][j1]. Calculate the result of doing this
-	if (xSection.empty())
+double calcRealInsertCost(const SolverContext &ctx, const SOL &S, int i, int j1, int xFront, int xBack, double internalX, const EVALINFO &info) {
+	//We are INSERTING the section xFront...xBack (empty if xFront is -1) before position S.items[i][j1]. Calculate the result of doing this
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
+	if (xFront == -1)
 		return S.routeLen[i] + info.dwellXSection;
 	else if (j1 == 0) 
-		return S.routeLen[i] + dTime[xSection.back()][S.items[i][j1]] + internalX + info.dwellXSection;
+		return S.routeLen[i] + dTime(xBack, S.items[i][j1]) + internalX + info.dwellXSection;
 	else if (j1 == S.items[i].size()) 
-		return S.routeLen[i] - dTime[S.items[i][j1 - 1]][0] + dTime[S.items[i][j1 - 1]][xSection.front()] + dTime[xSection.back()][0] + internalX + info.dwellXSection;
+		return S.routeLen[i] - dTime(S.items[i][j1 - 1], 0) + dTime(S.items[i][j1 - 1], xFront) + dTime(xBack, 0) + internalX + info.dwellXSection;
 	else 
-		return S.routeLen[i] - dTime[S.items[i][j1 - 1]][S.items[i][j1]] + dTime[S.items[i][j1 - 1]][xSection.front()] + dTime[xSection.back()][S.items[i][j1]] + internalX + info.dwellXSection;
+		return S.routeLen[i] - dTime(S.items[i][j1 - 1], S.items[i][j1]) + dTime(S.items[i][j1 - 1], xFront) + dTime(xBack, S.items[i][j1]) + internalX + info.dwellXSection;
 }
 
-void evaluateInsert(double &newCost, SOL &S, int i, int j1, int x, int y1, int y2, EVALINFO &info)
+void evaluateInsert(const SolverContext &ctx, double &newCost, const SOL &S, int i, int j1, int x, int y1, int y2, EVALINFO &info, const double *scanLen, const double *scanLenF)
 {
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
 	double newLenx, newLeni, newLeniF;
-	//We are insertnig a section from route x before position j1 in route i. Calculate the result of doing this
-	if (j1 == 0)						newLeni = S.routeLen[i] + dTime[S.items[x][y2 - 1]][S.items[i][j1]] + info.innerX + info.dwellXSection;
-	else if (j1 == S.items[i].size())	newLeni = S.routeLen[i] - dTime[S.items[i][j1 - 1]][0] + dTime[S.items[i][j1 - 1]][S.items[x][y1]] + dTime[S.items[x][y2 - 1]][0] + info.innerX + info.dwellXSection;
-	else								newLeni = S.routeLen[i] - dTime[S.items[i][j1 - 1]][S.items[i][j1]] + dTime[S.items[i][j1 - 1]][S.items[x][y1]] + dTime[S.items[x][y2 - 1]][S.items[i][j1]] + info.innerX + info.dwellXSection;
-	//Calculate the result of inserting the section flipped 
-	if (j1 == 0)						newLeniF = S.routeLen[i] + dTime[S.items[x][y1]][S.items[i][j1]] + info.innerXF + info.dwellXSection;
-	else if (j1 == S.items[i].size())	newLeniF = S.routeLen[i] - dTime[S.items[i][j1 - 1]][0] + dTime[S.items[i][j1 - 1]][S.items[x][y2 - 1]] + dTime[S.items[x][y1]][0] + info.innerXF + info.dwellXSection;
-	else								newLeniF = S.routeLen[i] - dTime[S.items[i][j1 - 1]][S.items[i][j1]] + dTime[S.items[i][j1 - 1]][S.items[x][y2 - 1]] + dTime[S.items[x][y1]][S.items[i][j1]] + info.innerXF + info.dwellXSection;
+	//We are insertnig a section from route x before position j1 in route i. Calculate the result of doing this. If
+	//scanLen and scanLenF are not NULL, they hold the lengths of route i for every j1 (see scanSectionInsert())
+	if (scanLen != NULL) {
+		newLeni = scanLen[j1];
+		newLeniF = scanLenF[j1];
+	}
+	else {
+		if (j1 == 0)						newLeni = S.routeLen[i] + dTime(S.items[x][y2 - 1], S.items[i][j1]) + info.innerX + info.dwellXSection;
+		else if (j1 == S.items[i].size())	newLeni = S.routeLen[i] - dTime(S.items[i][j1 - 1], 0) + dTime(S.items[i][j1 - 1], S.items[x][y1]) + dTime(S.items[x][y2 - 1], 0) + info.innerX + info.dwellXSection;
+		else								newLeni = S.routeLen[i] - dTime(S.items[i][j1 - 1], S.items[i][j1]) + dTime(S.items[i][j1 - 1], S.items[x][y1]) + dTime(S.items[x][y2 - 1], S.items[i][j1]) + info.innerX + info.dwellXSection;
+		//Calculate the result of inserting the section flipped 
+		if (j1 == 0)						newLeniF = S.routeLen[i] + dTime(S.items[x][y1], S.items[i][j1]) + info.innerXF + info.dwellXSection;
+		else if (j1 == S.items[i].size())	newLeniF = S.routeLen[i] - dTime(S.items[i][j1 - 1], 0) + dTime(S.items[i][j1 - 1], S.items[x][y2 - 1]) + dTime(S.items[x][y1], 0) + info.innerXF + info.dwellXSection;
+		else								newLeniF = S.routeLen[i] - dTime(S.items[i][j1 - 1], S.items[i][j1]) + dTime(S.items[i][j1 - 1], S.items[x][y2 - 1]) + dTime(S.items[x][y1], S.items[i][j1]) + info.innerXF + info.dwellXSection;
+	}
 	//Determine which is better and proceed with this result
 	if (newLeni <= newLeniF) info.flippedX = false;
 	else info.flippedX = true;
 	newLeni = minVal(newLeni, newLeniF);
 	//Finally calculate the result of removing the section from route x
-	if (y1 == 0) {
-		if (y2 == S.items[x].size())	newLenx = S.routeLen[x] - dTime[S.items[x][y2 - 1]][0] - info.innerX - info.dwellXSection;
-		else							newLenx = S.routeLen[x] - dTime[S.items[x][y2 - 1]][S.items[x][y2]] - info.innerX - info.dwellXSection;
-	}
-	else if (y2 == S.items[x].size())	newLenx = S.routeLen[x] - dTime[S.items[x][y1 - 1]][S.items[x][y1]] - dTime[S.items[x][y2 - 1]][0] + dTime[S.items[x][y1 - 1]][0] - info.innerX - info.dwellXSection;
-	else								newLenx = S.routeLen[x] - dTime[S.items[x][y1 - 1]][S.items[x][y1]] - dTime[S.items[x][y2 - 1]][S.items[x][y2]] + dTime[S.items[x][y1 - 1]][S.items[x][y2]] - info.innerX - info.dwellXSection;
+	newLenx = calcLenXSecRemoved(ctx, S, x, y1, y2, info);
 	
-	if (S.commonStop[x][i]) {
-		//If we are here we also need to cope with any duplicates and re-evaluate the routes with their removal
-		int y, pos;
-		double internalX = 0.0, dwellXSaving = 0.0;
-		bool dupInXSec = false;
-		tempVec1.clear();
-		//First flip the x section if needed
-		if (info.flippedX) { twoOpt(S.items[x], y1, y2 - 1); twoOpt(S.W[x], y1, y2 - 1); }
-		//And build up the actual x section that will be inserted into route i
-		for (y = y1; y < y2; y++) {
-			pos = checkForPresence(S, S.items[x][y], i);
-			if (pos == -1) {
-				//The item in route x at position y is not duplicated in route i, so it isn't removed
-				tempVec1.push_back(S.items[x][y]);
-				if (tempVec1.size() > 1) internalX += dTime[tempVec1[tempVec1.size() - 2]][tempVec1.back()];
-			}
-			else {
-				//The item in route x's section at position y is duplicated in route i, so we don't copy it and we record the associted stopping time
-				dwellXSaving += calcDwellTime(0);
-				dupInXSec = true;
-			}
+	if (S.commonStop(x, i)) {
+		//If we are here we also need to cope with any duplicates and re-evaluate the routes with their removal. If there
+		//is a duplicate somewhere, we recalculate the move, otherwise our previous calculation was correct
+		int xFront, xBack;
+		double internalX, dwellXSaving;
+		if (dedupSection(ctx, S, x, y1, y2, info.flippedX, i, 0, 0, xFront, xBack, internalX, dwellXSaving)) {
+			newLeni = calcRealInsertCost(ctx, S, i, j1, xFront, xBack, internalX, info) - dwellXSaving;
 		}
-		//If there is a duplicate somewhere, we recalculate the move, otherwise our previous calculation was correct
-		if (dupInXSec) {
-			newLeni = calcRealInsertCost(S, i, j1, tempVec1, internalX, info) - dwellXSaving;
-		}
-		//Flip the x section back if needed
-		if (info.flippedX) { twoOpt(S.items[x], y1, y2 - 1); twoOpt(S.W[x], y1, y2 - 1); }
 	}
-	newCost = S.cost - calcRCost(S.routeLen[x])	- calcRCost(S.routeLen[i]) + calcRCost(newLenx) + calcRCost(newLeni);
+	newCost = S.cost - calcRCost(ctx, S.routeLen[x])	- calcRCost(ctx, S.routeLen[i]) + calcRCost(ctx, newLenx) + calcRCost(ctx, newLeni);
 }
 
-void calcRealInterCost(double &newLenx, double &newLeni, SOL &S, int x, int y1, int y2, int i, int j1, int j2, 
-	vector<int> &xSection, vector<int> &iSection, double internalX, double internalI, EVALINFO &info,
+void calcRealInterCost(const SolverContext &ctx, double &newLenx, double &newLeni, const SOL &S, int x, int y1, int y2, int i, int j1, int j2, 
+	int xFront, int xBack, int iFront, int iBack, double internalX, double internalI, const EVALINFO &info,
 	double lenXSecRemoved, double lenISecRemoved) {
-	//We are swapping xSection and iSection. Calculate the result of doing this with the altered sections
-	if (xSection.empty())					newLeni = lenISecRemoved + info.dwellXSection;
+	//We are swapping the sections xFront...xBack and iFront...iBack (either empty if its front is -1). Calculate the result
+	//of doing this with the altered sections
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
+	if (xFront == -1)						newLeni = lenISecRemoved + info.dwellXSection;
 	else {
 		if (j1 == 0)
-			if (j2 == S.items[i].size())	newLeni = lenISecRemoved + dTime[xSection.back()][0] + internalX + info.dwellXSection;
-			else							newLeni = lenISecRemoved + dTime[xSection.back()][S.items[i][j2]] + internalX + info.dwellXSection;
-		else if (j2 == S.items[i].size())	newLeni = lenISecRemoved - dTime[S.items[i][j1 - 1]][0] + dTime[S.items[i][j1 - 1]][xSection.front()] + dTime[xSection.back()][0] + internalX + info.dwellXSection;
-		else								newLeni = lenISecRemoved - dTime[S.items[i][j1 - 1]][S.items[i][j2]] + dTime[S.items[i][j1 - 1]][xSection.front()] + dTime[xSection.back()][S.items[i][j2]] + internalX + info.dwellXSection;
+			if (j2 == S.items[i].size())	newLeni = lenISecRemoved + dTime(xBack, 0) + internalX + info.dwellXSection;
+			else							newLeni = lenISecRemoved + dTime(xBack, S.items[i][j2]) + internalX + info.dwellXSection;
+		else if (j2 == S.items[i].size())	newLeni = lenISecRemoved - dTime(S.items[i][j1 - 1], 0) + dTime(S.items[i][j1 - 1], xFront) + dTime(xBack, 0) + internalX + info.dwellXSection;
+		else								newLeni = lenISecRemoved - dTime(S.items[i][j1 - 1], S.items[i][j2]) + dTime(S.items[i][j1 - 1], xFront) + dTime(xBack, S.items[i][j2]) + internalX + info.dwellXSection;
 	}
-	if (iSection.empty())					newLenx = lenXSecRemoved + info.dwellISection;
+	if (iFront == -1)						newLenx = lenXSecRemoved + info.dwellISection;
 	else {
 		if (y1 == 0)
-			if (y2 == S.items[x].size())	newLenx = lenXSecRemoved + dTime[iSection.back()][0] + internalI + info.dwellISection;
-			else							newLenx = lenXSecRemoved + dTime[iSection.back()][S.items[x][y2]] + internalI + info.dwellISection;
-		else if (y2 == S.items[x].size())	newLenx = lenXSecRemoved - dTime[S.items[x][y1 - 1]][0] + dTime[S.items[x][y1 - 1]][iSection.front()] + dTime[iSection.back()][0] + internalI + info.dwellISection;
-		else								newLenx = lenXSecRemoved - dTime[S.items[x][y1 - 1]][S.items[x][y2]] + dTime[S.items[x][y1 - 1]][iSection.front()] + dTime[iSection.back()][S.items[x][y2]] + internalI + info.dwellISection;
+			if (y2 == S.items[x].size())	newLenx = lenXSecRemoved + dTime(iBack, 0) + internalI + info.dwellISection;
+			else							newLenx = lenXSecRemoved + dTime(iBack, S.items[x][y2]) + internalI + info.dwellISection;
+		else if (y2 == S.items[x].size())	newLenx = lenXSecRemoved - dTime(S.items[x][y1 - 1], 0) + dTime(S.items[x][y1 - 1], iFront) + dTime(iBack, 0) + internalI + info.dwellISection;
+		else								newLenx = lenXSecRemoved - dTime(S.items[x][y1 - 1], S.items[x][y2]) + dTime(S.items[x][y1 - 1], iFront) + dTime(iBack, S.items[x][y2]) + internalI + info.dwellISection;
 	}
 }
 
-void evaluateInter(double &newCost, SOL &S, int i, int j1, int j2, int x, int y1, int y2, EVALINFO &info)
+void evaluateInter(const SolverContext &ctx, double &newCost, const SOL &S, int i, int j1, int j2, int x, int y1, int y2, EVALINFO &info)
 {
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
 	double newLenx, newLeni, newLenxF, newLeniF, lenXSecRemoved, lenISecRemoved;
 	//We are swapping a nonempty section from route x with a nonempty section in route i. First calculate the result of removing the two sections)
-	if (y1 == 0) {
-		if (y2 == S.items[x].size())	lenXSecRemoved = S.routeLen[x] - dTime[S.items[x][y2 - 1]][0] - info.innerX - info.dwellXSection;
-		else							lenXSecRemoved = S.routeLen[x] - dTime[S.items[x][y2 - 1]][S.items[x][y2]] - info.innerX - info.dwellXSection;
-	}
-	else if (y2 == S.items[x].size())	lenXSecRemoved = S.routeLen[x] - dTime[S.items[x][y1 - 1]][S.items[x][y1]] - dTime[S.items[x][y2 - 1]][0] + dTime[S.items[x][y1 - 1]][0] - info.innerX - info.dwellXSection;
-	else								lenXSecRemoved = S.routeLen[x] - dTime[S.items[x][y1 - 1]][S.items[x][y1]] - dTime[S.items[x][y2 - 1]][S.items[x][y2]] + dTime[S.items[x][y1 - 1]][S.items[x][y2]] - info.innerX - info.dwellXSection;
+	lenXSecRemoved = calcLenXSecRemoved(ctx, S, x, y1, y2, info);
 	if (j1 == 0) {
-		if (j2 == S.items[i].size())	lenISecRemoved = S.routeLen[i] - dTime[S.items[i][j2 - 1]][0] - info.innerI - info.dwellISection;
-		else							lenISecRemoved = S.routeLen[i] - dTime[S.items[i][j2 - 1]][S.items[i][j2]] - info.innerI - info.dwellISection;
+		if (j2 == S.items[i].size())	lenISecRemoved = S.routeLen[i] - dTime(S.items[i][j2 - 1], 0) - info.innerI - info.dwellISection;
+		else							lenISecRemoved = S.routeLen[i] - dTime(S.items[i][j2 - 1], S.items[i][j2]) - info.innerI - info.dwellISection;
 	}
-	else if (j2 == S.items[i].size())	lenISecRemoved = S.routeLen[i] - dTime[S.items[i][j1 - 1]][S.items[i][j1]] - dTime[S.items[i][j2 - 1]][0] + dTime[S.items[i][j1 - 1]][0] - info.innerI - info.dwellISection;
-	else								lenISecRemoved = S.routeLen[i] - dTime[S.items[i][j1 - 1]][S.items[i][j1]] - dTime[S.items[i][j2 - 1]][S.items[i][j2]] + dTime[S.items[i][j1 - 1]][S.items[i][j2]] - info.innerI - info.dwellISection;
+	else if (j2 == S.items[i].size())	lenISecRemoved = S.routeLen[i] - dTime(S.items[i][j1 - 1], S.items[i][j1]) - dTime(S.items[i][j2 - 1], 0) + dTime(S.items[i][j1 - 1], 0) - info.innerI - info.dwellISection;
+	else								lenISecRemoved = S.routeLen[i] - dTime(S.items[i][j1 - 1], S.items[i][j1]) - dTime(S.items[i][j2 - 1], S.items[i][j2]) + dTime(S.items[i][j1 - 1], S.items[i][j2]) - info.innerI - info.dwellISection;
 	//Now calculate result of inserting the x section at position j1 in route i.
 	if (j1 == 0)
-		if (j2 == S.items[i].size())	newLeni = lenISecRemoved + dTime[S.items[x][y2 - 1]][0] + info.innerX + info.dwellXSection;
-		else							newLeni = lenISecRemoved + dTime[S.items[x][y2 - 1]][S.items[i][j2]] + info.innerX + info.dwellXSection;
-	else if (j2 == S.items[i].size())	newLeni = lenISecRemoved - dTime[S.items[i][j1 - 1]][0] + dTime[S.items[i][j1 - 1]][S.items[x][y1]] + dTime[S.items[x][y2 - 1]][0] + info.innerX + info.dwellXSection;
-	else								newLeni = lenISecRemoved - dTime[S.items[i][j1 - 1]][S.items[i][j2]] + dTime[S.items[i][j1 - 1]][S.items[x][y1]] + dTime[S.items[x][y2 - 1]][S.items[i][j2]] + info.innerX + info.dwellXSection;
+		if (j2 == S.items[i].size())	newLeni = lenISecRemoved + dTime(S.items[x][y2 - 1], 0) + info.innerX + info.dwellXSection;
+		else							newLeni = lenISecRemoved + dTime(S.items[x][y2 - 1], S.items[i][j2]) + info.innerX + info.dwellXSection;
+	else if (j2 == S.items[i].size())	newLeni = lenISecRemoved - dTime(S.items[i][j1 - 1], 0) + dTime(S.items[i][j1 - 1], S.items[x][y1]) + dTime(S.items[x][y2 - 1], 0) + info.innerX + info.dwellXSection;
+	else								newLeni = lenISecRemoved - dTime(S.items[i][j1 - 1], S.items[i][j2]) + dTime(S.items[i][j1 - 1], S.items[x][y1]) + dTime(S.items[x][y2 - 1], S.items[i][j2]) + info.innerX + info.dwellXSection;
 	//and the same flipped
 	if (j1 == 0)
-		if (j2 == S.items[i].size())	newLeniF = lenISecRemoved + dTime[S.items[x][y1]][0] + info.innerXF + info.dwellXSection;
-		else							newLeniF = lenISecRemoved + dTime[S.items[x][y1]][S.items[i][j2]] + info.innerXF + info.dwellXSection;
-	else if (j2 == S.items[i].size())	newLeniF = lenISecRemoved - dTime[S.items[i][j1 - 1]][0] + dTime[S.items[i][j1 - 1]][S.items[x][y2 - 1]] + dTime[S.items[x][y1]][0] + info.innerXF + info.dwellXSection;
-	else								newLeniF = lenISecRemoved - dTime[S.items[i][j1 - 1]][S.items[i][j2]] + dTime[S.items[i][j1 - 1]][S.items[x][y2 - 1]] + dTime[S.items[x][y1]][S.items[i][j2]] + info.innerXF + info.dwellXSection;
+		if (j2 == S.items[i].size())	newLeniF = lenISecRemoved + dTime(S.items[x][y1], 0) + info.innerXF + info.dwellXSection;
+		else							newLeniF = lenISecRemoved + dTime(S.items[x][y1], S.items[i][j2]) + info.innerXF + info.dwellXSection;
+	else if (j2 == S.items[i].size())	newLeniF = lenISecRemoved - dTime(S.items[i][j1 - 1], 0) + dTime(S.items[i][j1 - 1], S.items[x][y2 - 1]) + dTime(S.items[x][y1], 0) + info.innerXF + info.dwellXSection;
+	else								newLeniF = lenISecRemoved - dTime(S.items[i][j1 - 1], S.items[i][j2]) + dTime(S.items[i][j1 - 1], S.items[x][y2 - 1]) + dTime(S.items[x][y1], S.items[i][j2]) + info.innerXF + info.dwellXSection;
 	if (newLeni <= newLeniF) info.flippedX = false;
 	else info.flippedX = true;
 	newLeni = minVal(newLeni, newLeniF);
 	//Now calculate result of inserting the i section at position y1 in route x.
 	if (y1 == 0)
-		if (y2 == S.items[x].size())	newLenx = lenXSecRemoved + dTime[S.items[i][j2 - 1]][0] + info.innerI + info.dwellISection;
-		else							newLenx = lenXSecRemoved + dTime[S.items[i][j2 - 1]][S.items[x][y2]] + info.innerI + info.dwellISection;
-	else if (y2 == S.items[x].size())	newLenx = lenXSecRemoved - dTime[S.items[x][y1 - 1]][0] + dTime[S.items[x][y1 - 1]][S.items[i][j1]] + dTime[S.items[i][j2 - 1]][0] + info.innerI + info.dwellISection;
-	else								newLenx = lenXSecRemoved - dTime[S.items[x][y1 - 1]][S.items[x][y2]] + dTime[S.items[x][y1 - 1]][S.items[i][j1]] + dTime[S.items[i][j2 - 1]][S.items[x][y2]] + info.innerI + info.dwellISection;
+		if (y2 == S.items[x].size())	newLenx = lenXSecRemoved + dTime(S.items[i][j2 - 1], 0) + info.innerI + info.dwellISection;
+		else							newLenx = lenXSecRemoved + dTime(S.items[i][j2 - 1], S.items[x][y2]) + info.innerI + info.dwellISection;
+	else if (y2 == S.items[x].size())	newLenx = lenXSecRemoved - dTime(S.items[x][y1 - 1], 0) + dTime(S.items[x][y1 - 1], S.items[i][j1]) + dTime(S.items[i][j2 - 1], 0) + info.innerI + info.dwellISection;
+	else								newLenx = lenXSecRemoved - dTime(S.items[x][y1 - 1], S.items[x][y2]) + dTime(S.items[x][y1 - 1], S.items[i][j1]) + dTime(S.items[i][j2 - 1], S.items[x][y2]) + info.innerI + info.dwellISection;
 	//and the same flipped
 	if (y1 == 0)
-		if (y2 == S.items[x].size())	newLenxF = lenXSecRemoved + dTime[S.items[i][j1]][0] + info.innerIF + info.dwellISection;
-		else							newLenxF = lenXSecRemoved + dTime[S.items[i][j1]][S.items[x][y2]] + info.innerIF + info.dwellISection;
-	else if (y2 == S.items[x].size())	newLenxF = lenXSecRemoved - dTime[S.items[x][y1 - 1]][0] + dTime[S.items[x][y1 - 1]][S.items[i][j2 - 1]] + dTime[S.items[i][j1]][0] + info.innerIF + info.dwellISection;
-	else								newLenxF = lenXSecRemoved - dTime[S.items[x][y1 - 1]][S.items[x][y2]] + dTime[S.items[x][y1 - 1]][S.items[i][j2 - 1]] + dTime[S.items[i][j1]][S.items[x][y2]] + info.innerIF + info.dwellISection;
+		if (y2 == S.items[x].size())	newLenxF = lenXSecRemoved + dTime(S.items[i][j1], 0) + info.innerIF + info.dwellISection;
+		else							newLenxF = lenXSecRemoved + dTime(S.items[i][j1], S.items[x][y2]) + info.innerIF + info.dwellISection;
+	else if (y2 == S.items[x].size())	newLenxF = lenXSecRemoved - dTime(S.items[x][y1 - 1], 0) + dTime(S.items[x][y1 - 1], S.items[i][j2 - 1]) + dTime(S.items[i][j1], 0) + info.innerIF + info.dwellISection;
+	else								newLenxF = lenXSecRemoved - dTime(S.items[x][y1 - 1], S.items[x][y2]) + dTime(S.items[x][y1 - 1], S.items[i][j2 - 1]) + dTime(S.items[i][j1], S.items[x][y2]) + info.innerIF + info.dwellISection;
 	if (newLenx <= newLenxF) info.flippedI = false;
 	else info.flippedI = true;
 	newLenx = minVal(newLenx, newLenxF);
 	
-	if (S.commonStop[x][i]) {
-		//If we are here we need to cope with any duplicates and re-evaluate the routes with their removal
-		int y, j, pos;
-		double internalX = 0.0, internalI = 0.0, dwellXSaving = 0.0, dwellISaving = 0.0;
-		bool dupInXSec = false, dupInISec = false;
-		tempVec1.clear(); tempVec2.clear();
-		if (info.flippedX) { twoOpt(S.items[x], y1, y2 - 1); twoOpt(S.W[x], y1, y2 - 1); }
-		if (info.flippedI) { twoOpt(S.items[i], j1, j2 - 1); twoOpt(S.W[i], j1, j2 - 1); }
-		//Build up the actual x section that will be inserted into route i
-		for (y = y1; y < y2; y++) {
-			pos = checkForPresence(S, S.items[x][y], i, j1, j2);
-			if (pos == -1) {
-				//The item in route x at position y is not duplicated in route i, so it isn't removed
-				tempVec1.push_back(S.items[x][y]);
-				if (tempVec1.size() > 1) internalX += dTime[tempVec1[tempVec1.size() - 2]][tempVec1.back()];
-			}
-			else {
-				//The item in route x at position y is duplicated in route i, so we don't copy it and we remove the associted stoppIng time
-				dwellXSaving += calcDwellTime(0);
-				dupInXSec = true;
-			}
-		}
-		//And build up the actual i section that will be inserted into route x
-		for (j = j1; j < j2; j++) {
-			pos = checkForPresence(S, S.items[i][j], x, y1, y2);
-			if (pos == -1) {
-				//The item in route i at position j is not duplicated in route x, so it isn't removed
-				tempVec2.push_back(S.items[i][j]);
-				if (tempVec2.size() > 1) internalI += dTime[tempVec2[tempVec2.size() - 2]][tempVec2.back()];
-			}
-			else {
-				//The item in route x at position y is duplicated in route i, so we don't copy it and we remove the associted stoppIng time
-				dwellISaving += calcDwellTime(0);
-				dupInISec = true;
-			}
-		}
+	if (S.commonStop(x, i)) {
+		//If we are here we need to cope with any duplicates and re-evaluate the routes with their removal. Find the actual x
+		//section that will be inserted into route i, and the actual i section that will be inserted into route x
+		int xFront, xBack, iFront, iBack;
+		double internalX, internalI, dwellXSaving, dwellISaving;
+		bool dupInXSec = dedupSection(ctx, S, x, y1, y2, info.flippedX, i, j1, j2, xFront, xBack, internalX, dwellXSaving);
+		bool dupInISec = dedupSection(ctx, S, i, j1, j2, info.flippedI, x, y1, y2, iFront, iBack, internalI, dwellISaving);
 		if (dupInXSec || dupInISec) {
-			calcRealInterCost(newLenx, newLeni, S, x, y1, y2, i, j1, j2, tempVec1, tempVec2, internalX, internalI, info, lenXSecRemoved, lenISecRemoved);
+			calcRealInterCost(ctx, newLenx, newLeni, S, x, y1, y2, i, j1, j2, xFront, xBack, iFront, iBack, internalX, internalI, info, lenXSecRemoved, lenISecRemoved);
 			newLenx = newLenx - dwellISaving;
 			newLeni = newLeni - dwellXSaving;
 		}
-		if (info.flippedX) { twoOpt(S.items[x], y1, y2 - 1); twoOpt(S.W[x], y1, y2 - 1); }
-		if (info.flippedI) { twoOpt(S.items[i], j1, j2 - 1); twoOpt(S.W[i], j1, j2 - 1); }
 	}
-	newCost = S.cost - calcRCost(S.routeLen[x]) - calcRCost(S.routeLen[i]) + calcRCost(newLenx) + calcRCost(newLeni);
+	newCost = S.cost - calcRCost(ctx, S.routeLen[x]) - calcRCost(ctx, S.routeLen[i]) + calcRCost(ctx, newLenx) + calcRCost(ctx, newLeni);
 }
 
-void evaluateVertexCopy(double &newCost, SOL &S, int i, int j, int x) {
+void evaluateVertexCopy(const SolverContext &ctx, double &newCost, const SOL &S, int i, int j, int x, vector<double> &scratch) {
 	//Evaluate effect of copying v = S[i][j] into route x and then transferring some passengers to it
 	//Need to assume that the num of people boarding at S[i][j] is >= 2 and that spare capacity in route x is >= 1
+	const FlatMatrix<double> &dTime = ctx.inst->dTime;
+	const int maxBusCapacity = ctx.maxBusCapacity;
+	const double dwellPerPassenger = ctx.dwellPerPassenger;
+	const double maxJourneyTime = ctx.maxJourneyTime;
 	if (S.W[i][j] < 2 || maxBusCapacity - S.passInRoute[x] < 1) {
 		cout << "Error. Conditions not met for evaluateVertexCopy fn\n"; exit(1);
 	}
-	int v = S.items[i][j], pos = S.posInRoute[v][x], bestInsertPos = -1, spareCapX = maxBusCapacity - S.passInRoute[x], toTransfer;
-	double minCost, inserCost;
+	int v = S.items[i][j], pos = S.posInRoute.get(v, x), bestInsertPos = -1, spareCapX = maxBusCapacity - S.passInRoute[x], toTransfer;
 
 	if (pos == -1 && S.items[x].size() > 0) {
 		//Stop v is not in nonempty route x, so we look for the best point to insert it (before stop "bestInsertPos")
-		minCost = dTime[v][S.items[x][0]];
-		bestInsertPos = 0;
-		for (int u = 1; u < S.items[x].size(); u++) {
-			inserCost = dTime[S.items[x][u - 1]][v] + dTime[v][S.items[x][u]] - dTime[S.items[x][u - 1]][S.items[x][u]];
-			if (inserCost < minCost) {
-				minCost = inserCost;
-				bestInsertPos = u;
-			}
-		}
-		inserCost = dTime[S.items[x].back()][v] + dTime[v][0] - dTime[S.items[x].back()][0];
-		if (inserCost < minCost) {
-			minCost = inserCost;
-			bestInsertPos = S.items[x].size();
-		}
+		bestInsertPos = bestStopInsertPos(dTime, S.items[x], v, scratch, ctx.useSIMD);
 	}
 	//Calculate how many passengers we'll transfer from v in route i, to v in route j
 	if (S.routeLen[i] < maxJourneyTime) toTransfer = 1;
@@ -719,224 +750,471 @@ void evaluateVertexCopy(double &newCost, SOL &S, int i, int j, int x) {
 	else if (S.items[x].empty()) {
 		//We're inserting a copy of v into an empty route
 		newLeni = S.routeLen[i] - (dwellPerPassenger * toTransfer);
-		newLenx = S.routeLen[x] + dTime[v][0] + calcDwellTime(toTransfer);
+		newLenx = S.routeLen[x] + dTime(v, 0) + calcDwellTime(ctx, toTransfer);
 	}
 	else {
 		//We're making a copy of v and putting it into a nonempty route
 		newLeni = S.routeLen[i] - (dwellPerPassenger * toTransfer);
 		if (bestInsertPos == 0)
-			newLenx = S.routeLen[x] + dTime[v][S.items[x][0]] + calcDwellTime(toTransfer);
+			newLenx = S.routeLen[x] + dTime(v, S.items[x][0]) + calcDwellTime(ctx, toTransfer);
 		else if (bestInsertPos == S.items[x].size())
-			newLenx = S.routeLen[x] + dTime[S.items[x].back()][v] + dTime[v][0] + calcDwellTime(toTransfer) - dTime[S.items[x].back()][0];
+			newLenx = S.routeLen[x] + dTime(S.items[x].back(), v) + dTime(v, 0) + calcDwellTime(ctx, toTransfer) - dTime(S.items[x].back(), 0);
 		else
-			newLenx = S.routeLen[x] + dTime[S.items[x][bestInsertPos - 1]][v] + dTime[v][S.items[x][bestInsertPos]] + calcDwellTime(toTransfer) - dTime[S.items[x][bestInsertPos - 1]][S.items[x][bestInsertPos]];
+			newLenx = S.routeLen[x] + dTime(S.items[x][bestInsertPos - 1], v) + dTime(v, S.items[x][bestInsertPos]) + calcDwellTime(ctx, toTransfer) - dTime(S.items[x][bestInsertPos - 1], S.items[x][bestInsertPos]);
 	}
-	newCost = S.cost - calcRCost(S.routeLen[i]) - calcRCost(S.routeLen[x]) + calcRCost(newLeni) + calcRCost(newLenx);
+	newCost = S.cost - calcRCost(ctx, S.routeLen[i]) - calcRCost(ctx, S.routeLen[x]) + calcRCost(ctx, newLeni) + calcRCost(ctx, newLenx);
 }
 
-bool localSearch(SOL &S, double &feasRatio, int &numMoves)
+inline
+void offerMove(mt19937 &rng, MOVE &best, double delta, int type, int x, int y1, int y2, int i, int j1, int j2, int z, bool flippedX, bool flippedI)
 {
-	int x, y1, y2, i, j1, j2, z, chosenMove;
-	int besti, bestj1, bestj2, bestx, besty1, besty2, bestz, numBest = 0;
-	double newCost = 0, bestCost = 0;
-	long evalCnt = 0, evalFeasCnt = 0;
-	bool checkedEmpty, bestflippedx, bestflippedi;
-	EVALINFO info;
-	feasRatio = 0.0;
-	numMoves = 0;
-	vector<vector<int> > tempW;
-	vector<double> tempRouteLen;
-	vector<int> tempPassInRoute;
+	//Compares a move to the best seen so far, breaking ties uniformly at random
+	if (delta > best.delta) return;
+	if (delta < best.delta) best.numTied = 0;
+	if (rng() % (unsigned int)(best.numTied + 1) == 0) {
+		//Save the move with a certain probability
+		best.type = type; best.delta = delta;
+		best.x = x; best.y1 = y1; best.y2 = y2; best.i = i; best.j1 = j1; best.j2 = j2; best.z = z;
+		best.flippedX = flippedX; best.flippedI = flippedI;
+	}
+	best.numTied++;
+}
 
-	while (true) {
-		chosenMove = 0;
-		bestCost = DBL_MAX;
-		numBest = 0;
-		for (x = 0; x < S.items.size(); x++) {
-			/*Inter-route operators. Check cost of swapping sections (S[x][y1]...S[x][y2-1]) and sections (S[i][j1]...S[i][j2-1]).
-			where x != i. The latter section can be empty (j1==j2) in which case we insert (S[x][y1]...S[x][y2-1]) before the
-			position S[i][j1]. Route i can also be empty. If there is more than one empty route i, only one of these is evaluated*/
-			for (y1 = 0; y1 < S.items[x].size(); y1++) {
-				info.innerX = 0.0;
-				info.innerXF = 0.0;
-				info.dwellXSection = 0.0;
-				info.passXSection = 0;
-				for (y2 = y1 + 1; y2 <= S.items[x].size(); y2++) {
-					//Keep track of the total costs of the inernal edges in this section of route x (fwd and bkwds)
-					if (y2 > y1 + 1) {
-						info.innerX += dTime[S.items[x][y2 - 2]][S.items[x][y2 - 1]];
-						info.innerXF += dTime[S.items[x][y2 - 1]][S.items[x][y2 - 2]];
-					}
-					//Also keep track of the total dwell times in this section of route x
-					info.dwellXSection += calcDwellTime(S.W[x][y2 - 1]);
-					info.passXSection += S.W[x][y2 - 1];
-					checkedEmpty = false;
-					for (i = 0; i < S.items.size(); i++) {
-						if (x != i) {
-							if (S.items[i].empty() && checkedEmpty == false) {
-								//The neighbourhood operator involves one non-empty routes (x) and one empty route (i)
-								evaluateInterEmpty(newCost, S, i, x, y1, y2, info);
-								if (newCost <= bestCost) {
-									if (newCost < bestCost) numBest = 0;
-									if (rand() % (numBest + 1) == 0) {
-										//Save the move with a certain probability
-										chosenMove = 1;
-										bestCost = newCost; besti = i; bestx = x; besty1 = y1; besty2 = y2; bestflippedx = info.flippedX;
-									}
-									numBest++;
-								}
-								checkedEmpty = true;
-							}
-							else {
-								//The neighbourhood operator involves two non-empty routes, so loop through each section in route i
-								for (j1 = 0; j1 < S.items[i].size(); j1++) {
-									info.innerI = 0.0;
-									info.innerIF = 0.0;
-									info.dwellISection = 0.0;
-									info.passISection = 0;
-									for (j2 = j1; j2 <= S.items[i].size(); j2++) {
-										//Keep track of the total costs of the inernal edges of this section of route i (fwd and bkwds)
-										if (j2 > j1 + 1) {
-											info.innerI += dTime[S.items[i][j2 - 2]][S.items[i][j2 - 1]];
-											info.innerIF += dTime[S.items[i][j2 - 1]][S.items[i][j2 - 2]];
-										}
-										if (j2 > j1) {
-											info.dwellISection += calcDwellTime(S.W[i][j2 - 1]);
-											info.passISection += S.W[i][j2 - 1];
-										}
-										if (S.passInRoute[i] - info.passISection + info.passXSection <= maxBusCapacity && S.passInRoute[x] - info.passXSection + info.passISection <= maxBusCapacity) {
-											//The proposed move will retain the validity of the route capactities,
-											if (j1 == j2) {
-												//Inserting a section from route x into route i
-												evaluateInsert(newCost, S, i, j1, x, y1, y2, info);
-												if (newCost <= bestCost) {
-													if (newCost < bestCost) numBest = 0;
-													if (rand() % (numBest + 1) == 0) {
-														//Save the move with a certain probability
-														chosenMove = 2;
-														bestCost = newCost; besti = i; bestj1 = j1; bestj2 = j2; bestx = x; besty1 = y1; besty2 = y2; bestflippedx = info.flippedX; bestflippedi = info.flippedI;
-													}
-													numBest++;
-												}
-											}
-											else {
-												//Swapping a section from route x and a section of route i
-												evaluateInter(newCost, S, i, j1, j2, x, y1, y2, info);
-												if (newCost <= bestCost) {
-													if (newCost < bestCost) numBest = 0;
-													if (rand() % (numBest + 1) == 0) {
-														//Save the move with a certain probability
-														chosenMove = 3;
-														bestCost = newCost; besti = i; bestj1 = j1; bestj2 = j2; bestx = x; besty1 = y1; besty2 = y2; bestflippedx = info.flippedX; bestflippedi = info.flippedI;
-													}
-													numBest++;
-												}
-											}
-											evalFeasCnt++;
-										}
-										evalCnt++;
-									}
-								}
-							}
-						}
-					}
+//Bit masks of local search operators (move types 1-7)
+#define MOVEBIT(t) (1u << (t))
+const unsigned int ALL_MOVES = 0xFE;
+
+void clearMove(MOVE &m)
+{
+	m.type = 0;
+	m.delta = DBL_MAX;
+	m.numTied = 0;
+}
+
+void evaluateRoutePair(const SolverContext &ctx, const SOL &S, int x, int i, bool isFirstEmpty, unsigned int ops, MOVE &best, mt19937 &rng, LSWORKSPACE &ws)
+{
+	/*Inter-route operators. Check cost of swapping sections (S[x][y1]...S[x][y2-1]) and sections (S[i][j1]...S[i][j2-1]).
+	where x != i. The latter section can be empty (j1==j2) in which case we insert (S[x][y1]...S[x][y2-1]) before the
+	position S[i][j1]. Route i can also be empty. If there is more than one empty route i, only one of these (isFirstEmpty)
+	is evaluated. Only the move types in the bit mask ops are tried. The best move is written to best. Ties are broken with
+	rng, and ws gives the scratch space and counters*/
+	const int maxBusCapacity = ctx.maxBusCapacity;
+	RaggedArray<int>::ConstRow passPre = S.passPre[i];
+	int y1, y2, j1, j2, j2Lo, j2Hi, n = S.items[i].size(), minLoss, maxGain;
+	double newCost = 0, insBound = 0;
+	bool scanned, doSections = S.items[i].empty() ? (ops & MOVEBIT(1)) && isFirstEmpty : (ops & (MOVEBIT(2) | MOVEBIT(3))) != 0;
+	EVALINFO info;
+	clearMove(best);
+	for (y1 = 0; y1 < S.items[x].size() && doSections; y1++) {
+		for (y2 = y1 + 1; y2 <= S.items[x].size(); y2++) {
+			//Get the total costs of the inernal edges (fwd and bkwds), dwell times and passengers in this section of route x
+			getSectionX(S, x, y1, y2, info);
+			if (S.items[i].empty()) {
+				if (isFirstEmpty) {
+					//The neighbourhood operator involves one non-empty routes (x) and one empty route (i)
+					evaluateInterEmpty(ctx, newCost, S, i, x, y1, y2, info);
+					offerMove(rng, best, newCost - S.cost, 1, x, y1, y2, i, 0, 0, 0, info.flippedX, false);
+					ws.ops[1].evals++;
 				}
+				continue;
 			}
-			/*Inter-route operator that seeks to increase the number of multi-stops by copying stop v = S[i][j1] into route x at
-			the best position, where x != i. Route x may already contain v, or may also be empty, but v should have at least 2 boarding
-			passengers, and route x should have some spare capacity*/
-			for (i = 0; i < S.items.size(); i++) {
-				for (j1 = 0; j1 < S.items[i].size(); j1++) {
-					if (i != x) {
-						if (S.W[i][j1] > 1 && maxBusCapacity - S.passInRoute[x] >= 1) {
-							evaluateVertexCopy(newCost, S, i, j1, x);
-							if (newCost <= bestCost) {
-								if (newCost < bestCost) numBest = 0;
-								if (rand() % (numBest + 1) == 0) {
-									//Save the move with a certain probability
-									chosenMove = 7;
-									bestCost = newCost; besti = i; bestj1 = j1; bestx = x;
-								}
-								numBest++;
-							}
-						}
-					}
+			//The neighbourhood operator involves two non-empty routes. If inserting the x section into route i keeps within
+			//capacity, first find the length of route i for every insertion point in one pass
+			scanned = (ops & MOVEBIT(2)) && ctx.granularity <= 0 && S.passInRoute[i] + info.passXSection <= maxBusCapacity;
+			if (scanned) {
+				ws.insLen.resize(n + 1);
+				ws.insLenF.resize(n + 1);
+				scanSectionInsert(ctx.inst->dTime, S.items[i], S.routeLen[i], S.items[x][y1], S.items[x][y2 - 1], info.innerX, info.innerXF, info.dwellXSection, ws.insLen.data(), ws.insLenF.data(), ctx.useSIMD);
+				if (!S.commonStop(x, i)) {
+					//With no stops in common, no insertion of this section can do better than the shortest scanned length of
+					//route i, so the cost of using that length is a lower bound on the cost of every insert
+					insBound = ws.insLen[0];
+					for (j1 = 0; j1 < n; j1++) insBound = minVal(insBound, minVal(ws.insLen[j1], ws.insLenF[j1]));
+					insBound = S.cost - calcRCost(ctx, S.routeLen[x]) - calcRCost(ctx, S.routeLen[i]) + calcRCost(ctx, calcLenXSecRemoved(ctx, S, x, y1, y2, info)) + calcRCost(ctx, insBound) - S.cost;
 				}
+				else insBound = -DBL_MAX;
 			}
-			//Now look at the inter-route operators
-			if (!S.items[x].empty()) {
-				for (y1 = 0; y1 < S.items[x].size(); y1++) {
-					info.innerX = 0.0;
-					info.innerXF = 0.0;
-					for (y2 = y1; y2 < S.items[x].size(); y2++) {
-						if (y1 < y2) {
-							//Keep track of the total cost of the inernal edges of the section we are considering
-							info.innerX += dTime[S.items[x][y2 - 1]][S.items[x][y2]];
-							info.innerXF += dTime[S.items[x][y2]][S.items[x][y2 - 1]];
-							//Now check the cost of swap
-							evaluateSwapTwoOpt(newCost, S, x, y1, y2, 4, info);
-							if (newCost <= bestCost) {
-								if (newCost < bestCost) numBest = 0;
-								if (rand() % (numBest + 1) == 0) {
-									//Save the move with a certain probability
-									chosenMove = 4;
-									bestCost = newCost; bestx = x; besty1 = y1; besty2 = y2;
-								}
-								numBest++;
-							}
-							//And the cost of an inversion 
-							evaluateSwapTwoOpt(newCost, S, x, y1, y2, 5, info);
-							if (newCost <= bestCost) {
-								if (newCost < bestCost) numBest = 0;
-								if (rand() % (numBest + 1) == 0) {
-									//Save the move with a certain probability
-									chosenMove = 5;
-									bestCost = newCost; bestx = x; besty1 = y1; besty2 = y2;
-								}
-								numBest++;
-							}
-						}
-						//Now check cost of inserting section (y1,...y2) before point z
-						for (z = 0; z <= S.items[x].size(); z++) {
-							if (z == y1)
-								z = y2 + 1;
-							else {
-								evaluateOrOpt(newCost, S, x, y1, y2, z, info);
-								if (newCost <= bestCost) {
-									if (newCost < bestCost) numBest = 0;
-									if (rand() % (numBest + 1) == 0) {
-										//Save the move with a certain probability
-										chosenMove = 6;
-										bestCost = newCost; bestx = x; besty1 = y1; besty2 = y2; bestz = z; bestflippedx = info.flippedX;
-									}
-									numBest++;
-								}
-							}
-						}
+			//Now loop through each section in route i. For the move to respect capacities, route i must lose at least minLoss
+			//passengers and gain at most maxGain. Section loads only grow with j2, so the j2 values that do this form a range
+			//[j2Lo, j2Hi] that can be found by binary search on the route's passenger prefix sums
+			minLoss = S.passInRoute[i] + info.passXSection - maxBusCapacity;
+			maxGain = maxBusCapacity - S.passInRoute[x] + info.passXSection;
+			ws.evalCnt += (ops & MOVEBIT(3)) ? n * (n + 3) / 2 : n;
+			for (j1 = 0; j1 < n; j1++) {
+				j2Lo = lower_bound(passPre.begin() + j1, passPre.end(), passPre[j1] + minLoss) - passPre.begin();
+				j2Hi = upper_bound(passPre.begin() + j1, passPre.end(), passPre[j1] + maxGain) - passPre.begin() - 1;
+				//If no section starting at j1 is heavy enough, none starting later will be either
+				if (j2Lo > n) break;
+				//Without swaps only the insert (j2 == j1) is wanted, and without inserts only the swaps
+				if (!(ops & MOVEBIT(3))) j2Hi = min(j2Hi, j1);
+				if (!(ops & MOVEBIT(2))) j2Lo = max(j2Lo, j1 + 1);
+				for (j2 = j2Lo; j2 <= j2Hi; j2++) {
+					//The same for this (possibly empty) section of route i
+					getSectionI(S, i, j1, j2, info);
+					ws.evalFeasCnt++;
+					//The proposed move will retain the validity of the route capactities. With granular neighbourhoods, it is
+					//only evaluated if it joins a pair of candidate stops
+					if (ctx.granularity > 0 && !(j1 == j2 ? insertIsGranular(ctx, S, i, j1, x, y1, y2) : swapIsGranular(ctx, S, i, j1, j2, x, y1, y2))) {
+						//Move is outside the granular neighbourhood
+					}
+					else if (j1 == j2) {
+						//Inserting a section from route x into route i, unless we know it can't beat the best move so far
+						if (scanned && insBound > best.delta) continue;
+						evaluateInsert(ctx, newCost, S, i, j1, x, y1, y2, info, scanned ? ws.insLen.data() : NULL, scanned ? ws.insLenF.data() : NULL);
+						offerMove(rng, best, newCost - S.cost, 2, x, y1, y2, i, j1, j2, 0, info.flippedX, false);
+						ws.ops[2].evals++;
+						ws.evalDoneCnt++;
 					}
+					else {
+						//Swapping a section from route x and a section of route i
+						evaluateInter(ctx, newCost, S, i, j1, j2, x, y1, y2, info);
+						offerMove(rng, best, newCost - S.cost, 3, x, y1, y2, i, j1, j2, 0, info.flippedX, info.flippedI);
+						ws.ops[3].evals++;
+						ws.evalDoneCnt++;
+					}
+				}
+			}
+		}
+	}
+	/*Inter-route operator that seeks to increase the number of multi-stops by copying stop v = S[i][j1] into route x at
+	the best position. Route x may already contain v, or may also be empty, but v should have at least 2 boarding
+	passengers, and route x should have some spare capacity*/
+	for (j1 = 0; j1 < S.items[i].size() && (ops & MOVEBIT(7)); j1++) {
+		if (S.W[i][j1] > 1 && maxBusCapacity - S.passInRoute[x] >= 1) {
+			evaluateVertexCopy(ctx, newCost, S, i, j1, x, ws.insCost);
+			offerMove(rng, best, newCost - S.cost, 7, x, 0, 0, i, j1, 0, 0, false, false);
+			ws.ops[7].evals++;
+		}
+	}
+}
+
+void evaluateRoute(const SolverContext &ctx, const SOL &S, int x, unsigned int ops, MOVE &best, mt19937 &rng, LSWORKSPACE &ws)
+{
+	//Intra-route operators (swaps, inversions and or-opt moves within route x) that are in the bit mask ops. The best move
+	//is written to best, with ties broken using rng
+	int y1, y2, z;
+	double newCost = 0;
+	EVALINFO info;
+	clearMove(best);
+	for (y1 = 0; y1 < S.items[x].size(); y1++) {
+		for (y2 = y1; y2 < S.items[x].size(); y2++) {
+			//Get the total cost of the inernal edges of the section we are considering
+			getSectionX(S, x, y1, y2 + 1, info);
+			if (y1 < y2 && (ops & MOVEBIT(4))) {
+				//Now check the cost of swap
+				evaluateSwapTwoOpt(ctx, newCost, S, x, y1, y2, 4, info);
+				offerMove(rng, best, newCost - S.cost, 4, x, y1, y2, 0, 0, 0, 0, false, false);
+				ws.ops[4].evals++;
+			}
+			if (y1 < y2 && (ops & MOVEBIT(5))) {
+				//And the cost of an inversion 
+				evaluateSwapTwoOpt(ctx, newCost, S, x, y1, y2, 5, info);
+				offerMove(rng, best, newCost - S.cost, 5, x, y1, y2, 0, 0, 0, 0, false, false);
+				ws.ops[5].evals++;
+			}
+			//Now check cost of inserting section (y1,...y2) before point z
+			for (z = 0; z <= S.items[x].size() && (ops & MOVEBIT(6)); z++) {
+				if (z == y1)
+					z = y2 + 1;
+				else {
+					evaluateOrOpt(ctx, newCost, S, x, y1, y2, z, info);
+					offerMove(rng, best, newCost - S.cost, 6, x, y1, y2, 0, 0, 0, z, info.flippedX, false);
+					ws.ops[6].evals++;
 				}
 			}
 		}
-		//All neighbourhoods evaluated. We now do the neighbourhood move. First, if no improvement has been found, end. 
-		if (chosenMove == 0 || bestCost >= S.cost) {
-			break;
+	}
+}
+
+void doMove(SolverContext &ctx, SOL &S, const MOVE &m)
+{
+	double newCost = S.cost + m.delta;
+	if (m.type == 1)		doMove1(ctx, S, m.x, m.y1, m.y2, m.i, newCost, m.flippedX);
+	else if (m.type == 2)	doMove2(ctx, S, m.x, m.y1, m.y2, m.i, m.j1, newCost, m.flippedX);
+	else if (m.type == 3)	doMove3(ctx, S, m.x, m.y1, m.y2, m.i, m.j1, m.j2, newCost, m.flippedX, m.flippedI);
+	else if (m.type == 4)	doMove4(ctx, S, m.x, m.y1, m.y2, newCost);
+	else if (m.type == 5) 	doMove5(ctx, S, m.x, m.y1, m.y2, newCost);
+	else if (m.type == 6)	doMove6(ctx, S, m.x, m.y1, m.y2, m.z, newCost, m.flippedX);
+	else if (m.type == 7)	doMove7(ctx, S, m.x, m.i, m.j1, newCost);
+}
+
+int firstEmptyRoute(const SOL &S)
+{
+	for (int r = 0; r < S.items.size(); r++) if (S.items[r].empty()) return r;
+	return -1;
+}
+
+void evaluateEntry(const SolverContext &ctx, const SOL &S, int e, int firstEmpty, unsigned int ops, MOVE &best, mt19937 &rng, LSWORKSPACE &ws)
+{
+	/*Evaluates the operators in ops for entry e of the move cache. Entries e < k*k are the route pairs (e / k, e % k) and
+	the rest are the single routes e - k*k. The time taken is added to ws.ops. If several operators were evaluated, it is
+	shared between them in proportion to the number of moves each evaluated*/
+	int t, k = S.items.size();
+	long evals[8], numEvals = 0;
+	for (t = 1; t <= 7; t++) evals[t] = ws.ops[t].evals;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if (e < k * k) evaluateRoutePair(ctx, S, e / k, e % k, e % k == firstEmpty, ops, best, rng, ws);
+	else evaluateRoute(ctx, S, e - k * k, ops, best, rng, ws);
+	double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	for (t = 1; t <= 7; t++) {
+		evals[t] = ws.ops[t].evals - evals[t];
+		numEvals += evals[t];
+	}
+	for (t = 1; t <= 7 && numEvals > 0; t++) ws.ops[t].time += secs * evals[t] / numEvals;
+}
+
+void clearEvalCounts(LSWORKSPACE &ws)
+{
+	ws.evalCnt = ws.evalFeasCnt = ws.evalDoneCnt = 0;
+	for (int t = 0; t < 8; t++) ws.ops[t].evals = ws.ops[t].wins = 0, ws.ops[t].gain = ws.ops[t].time = 0.0;
+}
+
+void clearEvalCounts(SolverContext &ctx)
+{
+	clearEvalCounts(ctx.ls);
+}
+
+void addEvalCounts(LSWORKSPACE &ws, const LSWORKSPACE &other)
+{
+	ws.evalCnt += other.evalCnt;
+	ws.evalFeasCnt += other.evalFeasCnt;
+	ws.evalDoneCnt += other.evalDoneCnt;
+	for (int t = 0; t < 8; t++) {
+		ws.ops[t].evals += other.ops[t].evals;
+		ws.ops[t].wins += other.ops[t].wins;
+		ws.ops[t].gain += other.ops[t].gain;
+		ws.ops[t].time += other.ops[t].time;
+	}
+}
+
+void addEvalCounts(SolverContext &ctx, const SolverContext &other)
+{
+	//Adds the local search counters of another context (e.g. that of a worker thread) to those of ctx
+	addEvalCounts(ctx.ls, other.ls);
+}
+
+unsigned int taskSeed(unsigned long long base, unsigned long long task)
+{
+	//SplitMix64 hash of (base, task). Gives each parallel task its own random stream that does not depend on which
+	//thread happens to run it
+	unsigned long long z = base + (task + 1) * 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return (unsigned int)(z ^ (z >> 31));
+}
+
+void refreshMovesInParallel(SolverContext &ctx, const SOL &S, int firstEmpty)
+{
+	/*Parallel version of the cache refresh in localSearch(). Each dirty cache entry is a task. A task writes only to its
+	own entry and uses the workspace of the thread running it, with a random stream seeded from the task number. The
+	cache, and hence the move chosen, is therefore the same whatever the number of threads and however tasks are shared*/
+	int x, i, k = S.items.size();
+	vector<int> &tasks = ctx.dirtyEntries;
+	vector<char> &dirtyRoute = ctx.dirtyRoute;
+	tasks.clear();
+	for (x = 0; x < k; x++) {
+		for (i = 0; i < k; i++) {
+			if (x != i && (dirtyRoute[x] || dirtyRoute[i])) tasks.push_back(x * k + i);
+		}
+		if (dirtyRoute[x]) tasks.push_back(k * k + x);
+	}
+	unsigned long long base = ctx.rng();
+	ctx.lsWorkers.resize(ctx.lsPool->size());
+	for (LSWORKSPACE &ws : ctx.lsWorkers) clearEvalCounts(ws);
+	const SolverContext &cctx = ctx;
+	ctx.lsPool->parallelFor(tasks.size(), [&](int t, int w) {
+		LSWORKSPACE &ws = ctx.lsWorkers[w];
+		int e = tasks[t];
+		ws.rng.seed(taskSeed(base, e));
+		evaluateEntry(cctx, S, e, firstEmpty, ALL_MOVES, (e < k * k) ? ctx.pairMove[e] : ctx.routeMove[e - k * k], ws.rng, ws);
+	});
+	for (LSWORKSPACE &ws : ctx.lsWorkers) addEvalCounts(ctx.ls, ws);
+}
+
+bool pickBestMove(SolverContext &ctx, const SOL &S, int firstEmpty, MOVE &best)
+{
+	//Brings the whole move cache up to date and writes its best move to best. Returns false if this is not an improvement
+	int x, i, k = S.items.size(), numTied;
+	vector<char> &dirtyRoute = ctx.dirtyRoute;
+	if (ctx.lsPool != NULL) refreshMovesInParallel(ctx, S, firstEmpty);
+	else {
+		for (x = 0; x < k; x++) {
+			for (i = 0; i < k; i++) {
+				if (x != i && (dirtyRoute[x] || dirtyRoute[i])) evaluateEntry(ctx, S, x * k + i, firstEmpty, ALL_MOVES, ctx.pairMove[size_t(x) * k + i], ctx.rng, ctx.ls);
+			}
+			if (dirtyRoute[x]) evaluateEntry(ctx, S, k * k + x, firstEmpty, ALL_MOVES, ctx.routeMove[x], ctx.rng, ctx.ls);
+		}
+	}
+	fill(dirtyRoute.begin(), dirtyRoute.end(), 0);
+	//Now pick the best cached move. Ties are broken uniformly at random across all of the tied moves
+	clearMove(best);
+	numTied = 0;
+	for (x = 0; x < k; x++) {
+		for (i = 0; i <= k; i++) {
+			MOVE &m = (i < k) ? ctx.pairMove[size_t(x) * k + i] : ctx.routeMove[x];
+			if ((i < k && i == x) || m.type == 0 || m.delta > best.delta) continue;
+			if (m.delta < best.delta) numTied = 0;
+			numTied += m.numTied;
+			if (ctx.randInt(numTied) < m.numTied) best = m;
 		}
-		//Otherwise, do the chosen move and repeat.
-		if (chosenMove == 1)		doMove1(S, bestx, besty1, besty2, besti, bestCost, bestflippedx);
-		else if (chosenMove == 2)	doMove2(S, bestx, besty1, besty2, besti, bestj1, bestCost, bestflippedx);
-		else if (chosenMove == 3)	doMove3(S, bestx, besty1, besty2, besti, bestj1, bestj2, bestCost, bestflippedx, bestflippedi);
-		else if (chosenMove == 4)	doMove4(S, bestx, besty1, besty2, bestCost);
-		else if (chosenMove == 5) 	doMove5(S, bestx, besty1, besty2, bestCost);
-		else if (chosenMove == 6)	doMove6(S, bestx, besty1, besty2, bestz, bestCost, bestflippedx);
-		else if (chosenMove == 7)	doMove7(S, bestx, besti, bestj1, bestCost);
+	}
+	return best.type != 0 && best.delta < 0;
+}
+
+bool pickFirstImprovingMove(SolverContext &ctx, const SOL &S, int firstEmpty, int step, MOVE &best)
+{
+	/*Used in place of a full refresh of the move cache when ctx.firstImproving = N > 0. The cache entries are visited in
+	a random order, re-evaluating those that are out of date, until N entries holding an improving move have been seen. The
+	best of these is written to best, breaking ties at random. Entries that are not reached stay out of date until a later
+	step visits them. An entry is out of date if one of its routes has changed (routeStamp) since it was last evaluated
+	(moveStamp). Returns false if all entries were visited and none improve, so that S is a local optimum*/
+	int t, e, x, i, k = S.items.size(), numEntries = k * k + k, numFound = 0, numTied = 0;
+	vector<int> &order = ctx.moveOrder, &routeStamp = ctx.routeStamp, &moveStamp = ctx.moveStamp;
+	for (x = 0; x < k; x++) {
+		if (ctx.dirtyRoute[x]) routeStamp[x] = step;
+	}
+	fill(ctx.dirtyRoute.begin(), ctx.dirtyRoute.end(), 0);
+	clearMove(best);
+	for (t = 0; t < numEntries && numFound < ctx.firstImproving; t++) {
+		//Shuffle as we go, so a step that ends early only pays for the entries it visits
+		swap(order[t], order[t + ctx.randInt(numEntries - t)]);
+		e = order[t];
+		if (e < k * k) {
+			x = e / k;
+			i = e % k;
+			if (x == i) continue;
+		}
+		else x = i = e - k * k;
+		MOVE &m = (e < k * k) ? ctx.pairMove[e] : ctx.routeMove[x];
+		if (moveStamp[e] < routeStamp[x] || moveStamp[e] < routeStamp[i]) {
+			evaluateEntry(ctx, S, e, firstEmpty, ALL_MOVES, m, ctx.rng, ctx.ls);
+			moveStamp[e] = step;
+		}
+		if (m.type == 0 || m.delta >= 0) continue;
+		numFound++;
+		if (m.delta > best.delta) continue;
+		if (m.delta < best.delta) numTied = 0;
+		numTied += m.numTied;
+		if (ctx.randInt(numTied) < m.numTied) best = m;
+	}
+	return numFound > 0;
+}
+
+void orderOperators(SolverContext &ctx)
+{
+	/*Sets the order in which pickVNDMove() tries the operators. Operators that have so far given the most reduction in
+	cost per second spent evaluating them come first. Until an operator has been tried it keeps its place in the starting
+	order, which puts the cheap intra-route moves first and the section swaps last*/
+	static const int startOrder[7] = { 4, 5, 6, 1, 2, 7, 3 };
+	const OPSTATS *ops = ctx.ls.ops;
+	ctx.opOrder.assign(startOrder, startOrder + 7);
+	stable_sort(ctx.opOrder.begin(), ctx.opOrder.end(), [&](int a, int b) {
+		double scoreA = ops[a].time > 0 ? ops[a].gain / ops[a].time : DBL_MAX;
+		double scoreB = ops[b].time > 0 ? ops[b].gain / ops[b].time : DBL_MAX;
+		return scoreA > scoreB;
+	});
+}
+
+bool pickVNDMove(SolverContext &ctx, const SOL &S, int firstEmpty, int step, MOVE &best)
+{
+	/*Used in place of pickBestMove() when ctx.useVND is set. The operators are tried one at a time in the order ctx.opOrder.
+	Each has its own move cache (part of ctx.opMove), which is only brought up to date when the operator is tried, so the
+	later operators are only evaluated once the earlier ones have no improving move. The best move of the first operator
+	with an improving one is written to best. Entry ages work as in pickFirstImprovingMove(). Returns false if no operator
+	has an improving move*/
+	int e, x, i, k = S.items.size(), numEntries = k * k + k, numTied;
+	for (x = 0; x < k; x++) {
+		if (ctx.dirtyRoute[x]) ctx.routeStamp[x] = step;
+	}
+	fill(ctx.dirtyRoute.begin(), ctx.dirtyRoute.end(), 0);
+	for (int type : ctx.opOrder) {
+		//Operators 4-6 use the single route entries, the others the route pairs
+		bool isPairOp = type <= 3 || type == 7;
+		MOVE *cache = &ctx.opMove[size_t(type) * numEntries];
+		int *stamp = &ctx.opStamp[size_t(type) * numEntries];
+		clearMove(best);
+		numTied = 0;
+		for (e = isPairOp ? 0 : k * k; e < (isPairOp ? k * k : numEntries); e++) {
+			if (isPairOp && e / k == e % k) continue;
+			x = isPairOp ? e / k : e - k * k;
+			i = isPairOp ? e % k : x;
+			if (stamp[e] < ctx.routeStamp[x] || stamp[e] < ctx.routeStamp[i]) {
+				evaluateEntry(ctx, S, e, firstEmpty, MOVEBIT(type), cache[e], ctx.rng, ctx.ls);
+				stamp[e] = step;
+			}
+			MOVE &m = cache[e];
+			if (m.type == 0 || m.delta > best.delta) continue;
+			if (m.delta < best.delta) numTied = 0;
+			numTied += m.numTied;
+			if (ctx.randInt(numTied) < m.numTied) best = m;
+		}
+		if (best.type != 0 && best.delta < 0) return true;
+	}
+	return false;
+}
+
+bool localSearch(SolverContext &ctx, SOL &S, double &feasRatio, int &numMoves)
+{
+	/*Steepest descent using all seven neighbourhood operators. The best move involving each ordered pair of routes (x, i)
+	and each single route x is cached in ctx.pairMove and ctx.routeMove. A move only alters the routes it touches, so after
+	a move we only re-evaluate the cache entries that involve a changed ("dirty") route. If ctx.firstImproving > 0, each
+	step instead takes the best of the first few improving entries found (see pickFirstImprovingMove()). If ctx.useVND is set,
+	the operators are tried one at a time (see pickVNDMove())*/
+	int x, k = S.items.size(), firstEmpty, prevFirstEmpty;
+	long evalCnt = ctx.ls.evalCnt, evalFeasCnt = ctx.ls.evalFeasCnt;
+	vector<MOVE> &pairMove = ctx.pairMove, &routeMove = ctx.routeMove;
+	vector<char> &dirtyRoute = ctx.dirtyRoute;
+	MOVE best;
+	feasRatio = 0.0;
+	numMoves = 0;
+	pairMove.resize(size_t(k) * k);
+	routeMove.resize(k);
+	dirtyRoute.assign(k, 1);
+	firstEmpty = firstEmptyRoute(S);
+	if (ctx.useVND) {
+		ctx.routeStamp.assign(k, 0);
+		ctx.opMove.resize(8 * size_t(k * k + k));
+		ctx.opStamp.assign(8 * size_t(k * k + k), -1);
+		orderOperators(ctx);
+	}
+	else if (ctx.firstImproving > 0) {
+		ctx.routeStamp.assign(k, 0);
+		ctx.moveStamp.assign(k * k + k, -1);
+		ctx.moveOrder.resize(k * k + k);
+		for (x = 0; x < k * k + k; x++) ctx.moveOrder[x] = x;
+	}
+
+	while (true) {
+		//Choose a move. If no improvement has been found, end. 
+		if (ctx.useVND) {
+			if (!pickVNDMove(ctx, S, firstEmpty, numMoves, best)) break;
+		}
+		else if (ctx.firstImproving > 0) {
+			if (!pickFirstImprovingMove(ctx, S, firstEmpty, numMoves, best)) break;
+		}
+		else if (!pickBestMove(ctx, S, firstEmpty, best)) break;
+		//Otherwise, do the chosen move, mark the routes it changed, and repeat.
+		doMove(ctx, S, best);
 		numMoves++;
+		ctx.ls.ops[best.type].wins++;
+		ctx.ls.ops[best.type].gain -= best.delta;
+		dirtyRoute[best.x] = 1;
+		if (best.type <= 3 || best.type == 7) dirtyRoute[best.i] = 1;
+		//Only the first empty route is used by operator 1, so if this changes the entries of the old and new one are refreshed
+		prevFirstEmpty = firstEmpty;
+		firstEmpty = firstEmptyRoute(S);
+		if (firstEmpty != prevFirstEmpty) {
+			if (prevFirstEmpty != -1) dirtyRoute[prevFirstEmpty] = 1;
+			if (firstEmpty != -1) dirtyRoute[firstEmpty] = 1;
+		}
 	}
 
 	//We have finished the optimisation procedure
+	evalCnt = ctx.ls.evalCnt - evalCnt;
+	evalFeasCnt = ctx.ls.evalFeasCnt - evalFeasCnt;
 	if (evalCnt > 0) feasRatio = evalFeasCnt / double(evalCnt);
 	else feasRatio = 0.0;
 	
 	if (S.numFeasibleRoutes >= S.items.size()) return true;
 	else return false;
 }
-
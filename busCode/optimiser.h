@@ -3,6 +3,9 @@
 
 #include "main.h"
 
-bool localSearch(SOL &S, double &feasRatio, int &numMoves);
+void makeCandidateLists(SolverContext &ctx, FlatMatrix<char> &isCandidate);
+void clearEvalCounts(SolverContext &ctx);
+void addEvalCounts(SolverContext &ctx, const SolverContext &other);
+bool localSearch(SolverContext &ctx, SOL &S, double &feasRatio, int &numMoves);
 
 #endif //OPTIMISER_H
@@ -0,0 +1,102 @@
+#ifndef POSINDEX_H
+#define POSINDEX_H
+
+#include <vector>
+
+//The position of each stop in each route that contains it. A stop is only ever in a few routes, so rather than a
+//numStops x k matrix, each stop has SLOTS (route, position) pairs stored in place in one array. Should a stop be in more
+//routes than this, the rest go in a shared overflow list. A stop only has overflow entries if all of its slots are full,
+//so a lookup normally reads just the stop's 32 bytes of slots
+class PosIndex {
+public:
+	PosIndex() {}
+
+	void assign(int numStops) {
+		//Empties the index, making room for stops 0,...,(numStops - 1)
+		SLOT empty = { -1, -1 };
+		slots.assign(size_t(numStops) * SLOTS, empty);
+		overflow.clear();
+	}
+
+	inline int get(int stop, int route) const {
+		//Position of stop in route, or -1 if the route does not contain the stop
+		const SLOT *s = &slots[size_t(stop) * SLOTS];
+		for (int p = 0; p < SLOTS; p++) if (s[p].route == route) return s[p].pos;
+		if (s[SLOTS - 1].route == -1) return -1;
+		for (size_t p = 0; p < overflow.size(); p++) if (overflow[p].stop == stop && overflow[p].route == route) return overflow[p].pos;
+		return -1;
+	}
+
+	void set(int stop, int route, int pos) {
+		//Records that stop is at position pos of route
+		SLOT *s = &slots[size_t(stop) * SLOTS];
+		int p, hole = -1;
+		size_t q;
+		for (p = 0; p < SLOTS; p++) {
+			if (s[p].route == route) { s[p].pos = pos; return; }
+			if (s[p].route == -1 && hole == -1) hole = p;
+		}
+		if (hole != -1) {
+			s[hole].route = route;
+			s[hole].pos = pos;
+			return;
+		}
+		for (q = 0; q < overflow.size(); q++) {
+			if (overflow[q].stop == stop && overflow[q].route == route) { overflow[q].pos = pos; return; }
+		}
+		ENTRY e = { stop, route, pos };
+		overflow.push_back(e);
+	}
+
+	void erase(int stop, int route) {
+		//Records that route no longer contains stop. If this frees a slot, one of the stop's overflow entries moves into it
+		SLOT *s = &slots[size_t(stop) * SLOTS];
+		int p;
+		size_t q;
+		for (p = 0; p < SLOTS; p++) if (s[p].route == route) break;
+		if (p < SLOTS) {
+			s[p].route = s[p].pos = -1;
+			for (q = 0; q < overflow.size(); q++) {
+				if (overflow[q].stop == stop) {
+					s[p].route = overflow[q].route;
+					s[p].pos = overflow[q].pos;
+					overflow[q] = overflow.back();
+					overflow.pop_back();
+					break;
+				}
+			}
+			return;
+		}
+		for (q = 0; q < overflow.size(); q++) {
+			if (overflow[q].stop == stop && overflow[q].route == route) {
+				overflow[q] = overflow.back();
+				overflow.pop_back();
+				return;
+			}
+		}
+	}
+
+	void removeRoute(int route) {
+		//Used when (empty) route is deleted from a solution. Routes after it move down one place
+		for (size_t p = 0; p < slots.size(); p++) if (slots[p].route > route) slots[p].route--;
+		for (size_t p = 0; p < overflow.size(); p++) if (overflow[p].route > route) overflow[p].route--;
+	}
+
+	inline int numStops() const { return slots.size() / SLOTS; }
+
+private:
+	struct SLOT {
+		int route;		//-1 if the slot is free
+		int pos;
+	};
+	struct ENTRY {
+		int stop;
+		int route;
+		int pos;
+	};
+	static const int SLOTS = 4;
+	std::vector<SLOT> slots;		//Slots of stop v are in positions v * SLOTS,...,(v + 1) * SLOTS - 1
+	std::vector<ENTRY> overflow;	//Entries of stops that are in more than SLOTS routes
+};
+
+#endif //POSINDEX_H
@@ -0,0 +1,156 @@
+#ifndef RAGGED_H
+#define RAGGED_H
+
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+
+//A list of variable-length rows held in one array, for use in place of a vector of vectors. Every row has room for the
+//same number of elements (the row capacity), so row r starts at r * capacity and a whole RaggedArray is copied with a
+//couple of memcpys rather than one allocation per row. If a row outgrows the capacity, it is doubled and the rows are
+//laid out again. a[r] gives a lightweight view of row r with the vector operations the solver uses. Pointers into a
+//row are invalidated if the capacity changes. T must be a trivially copyable type.
+template <typename T>
+class RaggedArray {
+public:
+	class ConstRow;
+
+	class Row {
+	public:
+		Row(RaggedArray *owner, int r) : a(owner), r(r) {}
+		inline int size() const { return a->len[r]; }
+		inline bool empty() const { return a->len[r] == 0; }
+		inline T &operator[](int i) const { return a->data[size_t(r) * a->cap + i]; }
+		inline T &back() const { return (*this)[size() - 1]; }
+		inline T *begin() const { return &a->data[size_t(r) * a->cap]; }
+		inline T *end() const { return begin() + size(); }
+		inline void clear() const { a->len[r] = 0; }
+		inline void pop_back() const { a->len[r]--; }
+		inline void push_back(T val) const {
+			if (a->len[r] == a->cap) a->grow(a->len[r] + 1);
+			a->data[size_t(r) * a->cap + a->len[r]++] = val;
+		}
+		inline void resize(int n) const {
+			//New elements are left unset
+			if (n > a->cap) a->grow(n);
+			a->len[r] = n;
+		}
+		template <typename It>
+		void insert(T *pos, It first, It last) const { replace(pos, pos, first, last); }
+		inline void insert(T *pos, T val) const { replace(pos, pos, &val, &val + 1); }
+		inline void erase(T *first, T *last) const {
+			moveTail(last - begin(), -int(last - first));
+		}
+		inline void erase(T *pos) const { erase(pos, pos + 1); }
+		template <typename It>
+		void replace(T *first, T *last, It from, It to) const {
+			//Splices from,...,(to - 1) into the row in place of first,...,(last - 1). The rest of the row is moved once, by the
+			//difference in length, so swapping two sections of the same length takes time proportional to the section. The new
+			//elements may come from another row of this array: if the row capacity has to grow, they are copied out first
+			int p = first - begin(), q = last - begin(), n = to - from, d = n - (q - p);
+			if (a->len[r] + d > a->cap) {
+				std::vector<T> temp(from, to);
+				a->grow(a->len[r] + d);
+				moveTail(q, d);
+				std::copy(temp.begin(), temp.end(), begin() + p);
+			}
+			else {
+				moveTail(q, d);
+				std::copy(from, to, begin() + p);
+			}
+		}
+		inline operator ConstRow() const { return ConstRow(a, r); }
+	private:
+		RaggedArray *a;
+		int r;
+
+		inline void moveTail(int q, int d) const {
+			//Moves elements q,...,(size() - 1) d places along the row (back if d is negative). There must be room for them
+			if (d > 0) std::copy_backward(begin() + q, end(), end() + d);
+			else if (d < 0) std::copy(begin() + q, end(), begin() + q + d);
+			a->len[r] += d;
+		}
+	};
+
+	class ConstRow {
+	public:
+		ConstRow(const RaggedArray *owner, int r) : a(owner), r(r) {}
+		inline int size() const { return a->len[r]; }
+		inline bool empty() const { return a->len[r] == 0; }
+		inline const T &operator[](int i) const { return a->data[size_t(r) * a->cap + i]; }
+		inline const T &back() const { return (*this)[size() - 1]; }
+		inline const T *begin() const { return &a->data[size_t(r) * a->cap]; }
+		inline const T *end() const { return begin() + size(); }
+	private:
+		const RaggedArray *a;
+		int r;
+	};
+
+	RaggedArray() : cap(0) {}
+	RaggedArray(const RaggedArray &other) : cap(other.cap), len(other.len), data(other.data) {}
+	RaggedArray &operator=(const RaggedArray &other) { assignFrom(other); return *this; }
+
+	inline Row operator[](int r) { return Row(this, r); }
+	inline ConstRow operator[](int r) const { return ConstRow(this, r); }
+	inline int size() const { return len.size(); }
+
+	void assign(int numRows, int rowCap) {
+		//Makes the array numRows empty rows, each with room for rowCap elements
+		cap = rowCap > 0 ? rowCap : 1;
+		len.assign(numRows, 0);
+		data.resize(size_t(numRows) * cap);
+	}
+
+	void assignFrom(const RaggedArray &other) {
+		//Makes this array a copy of other, reusing the memory it already has. The row capacity is kept unless one of other's
+		//rows does not fit in it, so copying between solutions of the same instance rarely allocates
+		size_t r;
+		int maxLen = 0;
+		if (this == &other) return;
+		for (r = 0; r < other.len.size(); r++) if (other.len[r] > maxLen) maxLen = other.len[r];
+		if (cap == other.cap || cap < maxLen) {
+			//Same layout as other, so copy the whole buffer
+			cap = other.cap;
+			data = other.data;
+		}
+		else {
+			data.resize(other.len.size() * size_t(cap));
+			for (r = 0; r < other.len.size(); r++) {
+				std::copy(other.data.begin() + r * other.cap, other.data.begin() + r * other.cap + other.len[r], data.begin() + r * cap);
+			}
+		}
+		len = other.len;
+	}
+
+	void addRow() {
+		//Adds an empty row at the end
+		len.push_back(0);
+		data.resize(len.size() * size_t(cap));
+	}
+
+	void eraseRow(int r) {
+		//Removes row r. The rows after it move up one place
+		data.erase(data.begin() + size_t(r) * cap, data.begin() + size_t(r + 1) * cap);
+		len.erase(len.begin() + r);
+	}
+
+private:
+	int cap;					//Room for this many elements in each row
+	std::vector<int> len;		//Number of elements in each row
+	std::vector<T> data;		//Row r is in positions r * cap,...,r * cap + len[r] - 1
+
+	void grow(int needed) {
+		//Increases the row capacity to at least needed
+		int i, newCap = cap;
+		size_t r;
+		while (newCap < needed) newCap *= 2;
+		std::vector<T> old(len.size() * size_t(newCap));
+		old.swap(data);
+		for (r = 0; r < len.size(); r++) {
+			for (i = 0; i < len[r]; i++) data[size_t(r) * newCap + i] = old[size_t(r) * cap + i];
+		}
+		cap = newCap;
+	}
+};
+
+#endif //RAGGED_H
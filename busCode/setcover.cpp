@@ -1,36 +1,11 @@
 #include "setcover.h"
 
-extern vector<STOP> stops;
-extern vector<ADDR> addresses;
-extern vector<bool> isOutlier;
-extern vector<vector<double> > dDist;
-extern vector<vector<double> > dTime;
-extern vector<vector<double> > wDist;
-extern vector<vector<double> > wTime;
-extern vector<vector<int> > stopAdjList;
-extern vector<vector<int> > addrAdjList;
-extern vector<vector<bool> > addrStopAdj;
-extern int totalPassengers, maxBusCapacity;
-extern double maxWalkDist;
-extern double minEligibilityDist;
-extern string BingKey;
-extern string distUnits;
-extern double dwellPerPassenger;
-extern double dwellPerStop;
-extern double excessWeight;
-extern double maxJourneyTime;
-extern bool useMinCoverings;
-
-//Some temporary vectors used in the covering functions
-vector<int> Y, tempVec, perm;
-vector<vector<int> > X;
-
-int chooseRandomSet(vector<vector<int> > &X) {
+int chooseRandomSet(SolverContext &ctx, vector<int> &numUncovered) {
 	//Chooses any set with an element to cover, breaking ties randomly
 	int i, pos = -1, numChoices = 0;
-	for (i = 1; i < X.size(); i++) {
-		if (X[i].size() > 0) {
-			if (rand() % (numChoices + 1) == 0) {
+	for (i = 1; i < numUncovered.size(); i++) {
+		if (numUncovered[i] > 0) {
+			if (ctx.randInt(numChoices + 1) == 0) {
 				pos = i;
 			}
 			numChoices++;
@@ -40,37 +15,55 @@ int chooseRandomSet(vector<vector<int> > &X) {
 	else return pos;
 }
 
-int chooseBiggestSet(vector<vector<int> > &X) {
+int chooseBiggestSet(SolverContext &ctx, BucketQueue &Q) {
 	//Chooses the biggest set (stop with the most unvisited addresses), breaking ties randomly
-	int i, max = 0, maxPos = -1, numChoices = 0;
-	for (i = 1; i < X.size(); i++) {
-		if (X[i].size() >= max) {
-			if (X[i].size() > max) numChoices = 0;
-			if (rand() % (numChoices + 1) == 0) {
-				max = X[i].size();
-				maxPos = i;
+	int max = Q.maxKey();
+	if (max == 0) { cout << "Error in chooseBiggestSet function. Ending...\n"; exit(1); }
+	const vector<int> &B = Q.bucket(max);
+	return B[ctx.randInt(B.size())];
+}
+
+int coverAddresses(SolverContext &ctx, int x, int forbidden, BucketQueue *Q) {
+	//Marks the addresses adjacent to stop x as covered and returns how many of them were previously uncovered. Each
+	//stop's count of uncovered addresses is updated to match (the forbidden stop's count stays at zero), as are the
+	//keys in Q if it is not NULL
+	const COVERSETS &coverSets = ctx.inst->coverSets;
+	const WALKS &walks = ctx.inst->walks;
+	vector<int> &numUncovered = ctx.numUncovered;
+	vector<char> &addrCovered = ctx.addrCovered;
+	const int *a;
+	int p, v, cnt = 0;
+	for (a = coverSets.begin(x); a != coverSets.end(x); a++) {
+		if (addrCovered[*a]) continue;
+		addrCovered[*a] = 1;
+		cnt++;
+		for (p = walks.start[*a]; p < walks.start[*a + 1]; p++) {
+			v = walks.stop[p];
+			if (v != forbidden) {
+				numUncovered[v]--;
+				if (Q != NULL) Q->decrement(v);
 			}
-			numChoices++;
 		}
 	}
-	if (maxPos == -1) { cout << "Error in chooseBiggestSet function. Ending...\n"; exit(1); }
-	else return maxPos;
+	return cnt;
 }
 
-void getClosestStops(vector<bool> &stopUsed) {
+void getClosestStops(const SolverContext &ctx, vector<bool> &stopUsed) {
 	//Creates a covering by simply taking the closest stop to each address
 	int i;
-	for (i = 0; i < addresses.size(); i++) {
-		stopUsed[addrAdjList[i][0]] = true;
+	for (i = 0; i < ctx.inst->addresses.size(); i++) {
+		stopUsed[ctx.inst->walks.adjStop(i, 0)] = true;
 	}
 }
 
-void makeCoveringMinimal(vector<bool> &stopUsed) {
+void makeCoveringMinimal(SolverContext &ctx, vector<bool> &stopUsed) {
 	//This checks the covering is minimal. If it is not, bus stops are removed in a random order to make it minimal. 
+	const vector<vector<int> > &stopAdjList = ctx.inst->stopAdjList;
+	vector<int> &Y = ctx.Y, &tempVec = ctx.tempVec;
 	int i, j, r, stop;
 	tempVec.clear();
 	Y.clear();
-	Y.resize(addresses.size(), 0);
+	Y.resize(ctx.inst->addresses.size(), 0);
 	//Make a list of all stops being used
 	for (i = 1; i < stopUsed.size(); i++) {
 		if (stopUsed[i]) tempVec.push_back(i);
@@ -82,7 +75,7 @@ void makeCoveringMinimal(vector<bool> &stopUsed) {
 	}
 	//Now, for each used stop in a random order, see if removing this stop causes an address to have no suitable stop; in which 
 	//case the stop is definately needed. If it is not needed, then it is removed
-	randPermute(tempVec);
+	randPermute(ctx, tempVec);
 	for (i = 0; i < tempVec.size(); i++) {
 		stop = tempVec[i];
 		//Check if removing "stop" would give us an incomplete covering
@@ -97,78 +90,281 @@ void makeCoveringMinimal(vector<bool> &stopUsed) {
 	}
 }
 
-void generateNewCovering(vector<bool> &stopUsed, int forbidden, int heuristic) {
+//-------------- Bitset versions of the set covering procedures (used when useBitCovering is set) -------------------
+//Each stop's set of addresses is a row of the instance's coverBits, and the uncovered addresses are a bitset of the same
+//width, so the number of uncovered addresses at a stop is the popcount of the AND of the two. The stops chosen are the
+//same as with the lists except in heuristic 1, where ties are broken by a different (but still uniform) random choice
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_POPCNT
+#endif
+
+#ifdef HAVE_X86_POPCNT
+__attribute__((target("popcnt")))
+int countCommonPOPCNT(const uint64_t *a, const uint64_t *b, int words) {
+	//As countCommon(), using the CPU's popcount instruction
+	int w, cnt = 0;
+	for (w = 0; w < words; w++) cnt += __builtin_popcountll(a[w] & b[w]);
+	return cnt;
+}
+#endif
+
+int countCommon(const uint64_t *a, const uint64_t *b, int words) {
+	//Number of bits set in both a and b
+#ifdef HAVE_X86_POPCNT
+	static const bool hasPopcnt = __builtin_cpu_supports("popcnt");
+	if (hasPopcnt) return countCommonPOPCNT(a, b, words);
+#endif
+	int w, cnt = 0;
+	for (w = 0; w < words; w++) cnt += __builtin_popcountll(a[w] & b[w]);
+	return cnt;
+}
+
+inline
+bool anyCommon(const uint64_t *a, const uint64_t *b, int words) {
+	//True if a and b have a bit set in common
+	for (int w = 0; w < words; w++) if (a[w] & b[w]) return true;
+	return false;
+}
+
+int coverAddressesBits(uint64_t *U, const uint64_t *set, int words) {
+	//Removes the addresses in set from the uncovered addresses U and returns how many were removed
+	int cnt = countCommon(U, set, words);
+	for (int w = 0; w < words; w++) U[w] &= ~set[w];
+	return cnt;
+}
+
+int chooseRandomSetBits(SolverContext &ctx, const uint64_t *U, int forbidden) {
+	//As chooseRandomSet(), for a set of uncovered addresses U
+	const BitMatrix &coverBits = ctx.inst->coverBits;
+	int i, pos = -1, numChoices = 0, words = coverBits.rowWords();
+	for (i = 1; i < coverBits.rows(); i++) {
+		if (i != forbidden && anyCommon(U, coverBits.row(i), words)) {
+			if (ctx.randInt(numChoices + 1) == 0) {
+				pos = i;
+			}
+			numChoices++;
+		}
+	}
+	if (pos == -1) { cout << "Error in chooseRandomSetBits function. Ending...\n"; exit(1); }
+	else return pos;
+}
+
+int chooseBiggestSetBits(SolverContext &ctx, const uint64_t *U, int forbidden) {
+	//As chooseBiggestSet(), for a set of uncovered addresses U
+	const BitMatrix &coverBits = ctx.inst->coverBits;
+	int i, c, max = 1, maxPos = -1, numChoices = 0, words = coverBits.rowWords();
+	for (i = 1; i < coverBits.rows(); i++) {
+		if (i == forbidden) continue;
+		c = countCommon(U, coverBits.row(i), words);
+		if (c >= max) {
+			if (c > max) numChoices = 0;
+			if (ctx.randInt(numChoices + 1) == 0) {
+				max = c;
+				maxPos = i;
+			}
+			numChoices++;
+		}
+	}
+	if (maxPos == -1) { cout << "Error in chooseBiggestSetBits function. Ending...\n"; exit(1); }
+	else return maxPos;
+}
+
+void makeCoveringMinimalBits(SolverContext &ctx, vector<bool> &stopUsed) {
+	//As makeCoveringMinimal(). The addresses covered exactly once are also kept as a bitset (row 1 of coverWork), so
+	//checking whether a stop can be removed is an AND of two bitsets; the counts themselves are still updated via the lists
+	const BitMatrix &coverBits = ctx.inst->coverBits;
+	const COVERSETS &coverSets = ctx.inst->coverSets;
+	vector<int> &Y = ctx.Y, &tempVec = ctx.tempVec;
+	const int *a;
+	int i, stop, words = coverBits.rowWords();
+	//coverWork is only sized by generateNewCoveringBits(), which a trajectory using heuristic 3 never calls
+	if (ctx.coverWork.rows() != 2 || ctx.coverWork.cols() != coverBits.cols()) ctx.coverWork.assign(2, coverBits.cols());
+	uint64_t *once = ctx.coverWork.row(1);
+	tempVec.clear();
+	Y.assign(coverBits.cols(), 0);
+	for (i = 1; i < stopUsed.size(); i++) {
+		if (stopUsed[i]) tempVec.push_back(i);
+	}
+	for (i = 0; i < tempVec.size(); i++) {
+		for (a = coverSets.begin(tempVec[i]); a != coverSets.end(tempVec[i]); a++) Y[*a]++;
+	}
+	for (i = 0; i < words; i++) once[i] = 0;
+	for (i = 0; i < Y.size(); i++) if (Y[i] == 1) once[i >> 6] |= uint64_t(1) << (i & 63);
+	randPermute(ctx, tempVec);
+	for (i = 0; i < tempVec.size(); i++) {
+		stop = tempVec[i];
+		if (!anyCommon(coverBits.row(stop), once, words)) {
+			//If we are here then "stop" can be removed from the solution
+			for (a = coverSets.begin(stop); a != coverSets.end(stop); a++) {
+				if (--Y[*a] == 1) once[*a >> 6] |= uint64_t(1) << (*a & 63);
+			}
+			stopUsed[stop] = false;
+		}
+	}
+}
+
+void generateNewCoveringBits(SolverContext &ctx, vector<bool> &stopUsed, int forbidden, int heuristic) {
+	//As generateNewCovering()
+	const BitMatrix &coverBits = ctx.inst->coverBits;
+	int w, x, cnt = 0, m = coverBits.cols(), words = coverBits.rowWords();
+	if (ctx.coverWork.rows() != 2 || ctx.coverWork.cols() != m) ctx.coverWork.assign(2, m);
+	//Row 0 of coverWork holds the uncovered addresses; to start with, all of them
+	uint64_t *U = ctx.coverWork.row(0);
+	for (w = 0; w < words; w++) U[w] = ~uint64_t(0);
+	if (m % 64 != 0) U[words - 1] = (uint64_t(1) << (m % 64)) - 1;
+
+	for (x = 1; x < stopUsed.size(); x++) {
+		if (stopUsed[x] == true && x != forbidden) cnt += coverAddressesBits(U, coverBits.row(x), words);
+	}
+	while (cnt < m) {
+		if (heuristic == 1) x = chooseBiggestSetBits(ctx, U, forbidden);
+		else x = chooseRandomSetBits(ctx, U, forbidden);
+		cnt += coverAddressesBits(U, coverBits.row(x), words);
+		stopUsed[x] = true;
+	}
+
+	if (ctx.useMinCoverings) {
+		makeCoveringMinimalBits(ctx, stopUsed);
+	}
+}
+
+void generateNewCovering(SolverContext &ctx, vector<bool> &stopUsed, int forbidden, int heuristic) {
 	//Executes a greedy set covering algorithm to determine a subset of bus stops to use.
 	//Uses the global variable "makeCoveringMinimal" to determine whether the set of bus stops should correspond to a minimal covering (invoking a procedure at the end)
 	//"Forbidden" defines a single stop that should not be included in this covering (if it is -1 then all are allowed)
 	//Heuristic: 1: choose set with most uncovered elements at each iteration
 	//           2: choose any set with an uncovered element at each iteration
-	int i, j, x, cnt = 0;
-	X.clear();
-	X.resize(stops.size());
-	tempVec.clear();
+	const vector<STOP> &stops = ctx.inst->stops;
+	const vector<ADDR> &addresses = ctx.inst->addresses;
+	const COVERSETS &coverSets = ctx.inst->coverSets;
+	vector<int> &numUncovered = ctx.numUncovered;
+	BucketQueue &Q = ctx.coverQueue;
+	int x, cnt = 0, maxSize = 0;
 
-	//Set up a multiset of sets X, each set is the adjacencies of a stop (in lexicographic order)	
-	for (i = 1; i < stops.size(); i++) {
-		for (j = 0; j < addresses.size(); j++) {
-			if (addrStopAdj[j][i]) X[i].push_back(j);
-		}
+	if (ctx.useBitCovering) {
+		generateNewCoveringBits(ctx, stopUsed, forbidden, heuristic);
+		return;
+	}
+
+	//Rather than copying the sets (the adjacencies of each stop, precomputed by readInput()), we keep track of which
+	//addresses are covered and how many uncovered addresses each set still contains
+	ctx.addrCovered.assign(addresses.size(), 0);
+	numUncovered.resize(stops.size());
+	for (x = 0; x < stops.size(); x++) {
+		numUncovered[x] = coverSets.size(x);
+		if (numUncovered[x] > maxSize) maxSize = numUncovered[x];
 	}
 
 	//This is optional and stops a particular stop from being selected as part of the covering
-	if (forbidden >= 0 && forbidden < X.size()) {
-		X[forbidden].clear();
+	if (forbidden >= 0 && forbidden < stops.size()) {
+		numUncovered[forbidden] = 0;
 	}
 
 	//Now, if the stopUsed contains any true values, add these to the covering (they are already conributing to the covering)
 	for(x = 1; x < stops.size(); x++) {
-		if (stopUsed[x] == true) {
-			cnt += X[x].size();
-			//Remove the items in X[x] from all other sets X[i]
-			for (i = 1; i < X.size(); i++) {
-				if (i != x) {
-					//Remove elements of X[x] from X[i] (i.e. Calculate (X[i] setminus X[x]) and put the results back into X[i])
-					tempVec.clear();
-					set_difference(X[i].begin(), X[i].end(), X[x].begin(), X[x].end(), back_inserter(tempVec));
-					X[i].swap(tempVec);
-				}
-			}
-			X[x].clear();
+		if (stopUsed[x] == true && x != forbidden) {
+			cnt += coverAddresses(ctx, x, forbidden, NULL);
 		}
 	}
 
 	if (cnt < addresses.size()) {
-		//If we are here, the covering is incomplete, so we repeatedly select sets (bus stops) until we have a complete covering
+		//If we are here, the covering is incomplete, so we repeatedly select sets (bus stops) until we have a complete covering.
+		//For heuristic 1 the stops are held in a bucket queue keyed on their uncovered counts, so that each choice does not
+		//need a scan of all the stops
+		if (heuristic == 1) {
+			Q.assign(stops.size(), maxSize);
+			for (x = 1; x < stops.size(); x++) Q.insert(x, numUncovered[x]);
+		}
 		while (true) {
 			if (heuristic == 1) {
-				x = chooseBiggestSet(X);
+				x = chooseBiggestSet(ctx, Q);
 			}
 			else {
-				x = chooseRandomSet(X);
+				x = chooseRandomSet(ctx, numUncovered);
 			}
-			cnt += X[x].size();
+			cnt += coverAddresses(ctx, x, forbidden, heuristic == 1 ? &Q : NULL);
 			stopUsed[x] = true;
-			//Remove the items in X[x] from all other sets X[i]
-			for (i = 1; i < X.size(); i++) {
-				if (i != x) {
-					tempVec.clear();
-					set_difference(X[i].begin(), X[i].end(), X[x].begin(), X[x].end(), back_inserter(tempVec));
-					X[i].swap(tempVec);
-				}
-			}
-			X[x].clear();
 			if (cnt >= addresses.size()) break;
 		}
 	}
 
 	//If necesarry, now ensure that this covering is minimal
-	if (useMinCoverings) {
-		makeCoveringMinimal(stopUsed);
+	if (ctx.useMinCoverings) {
+		makeCoveringMinimal(ctx, stopUsed);
+	}
+}
+
+void repairCovering(SolverContext &ctx, vector<bool> &stopUsed, const vector<int> &removed, int forbidden) {
+	//Used when the stops in removed have just been taken out of a complete covering. Only the addresses left uncovered by
+	//this, and the stops adjacent to them, are looked at. These addresses are then covered in the same way as
+	//generateNewCovering() with heuristic 2, giving the same result in time proportional to the size of this neighbourhood.
+	//The forbidden stop is not reselected
+	const COVERSETS &coverSets = ctx.inst->coverSets;
+	const WALKS &walks = ctx.inst->walks;
+	vector<int> &stopNeed = ctx.stopNeed, &needStops = ctx.needStops, &needAddrs = ctx.needAddrs;
+	vector<char> &addrNeed = ctx.addrNeed;
+	const int *a;
+	int i, p, v, x, numChoices, cnt = 0;
+	//stopNeed and addrNeed are all zero between calls
+	if (stopNeed.size() != stopUsed.size()) stopNeed.assign(stopUsed.size(), 0);
+	if (addrNeed.size() != ctx.inst->addresses.size()) addrNeed.assign(ctx.inst->addresses.size(), 0);
+	needStops.clear();
+	needAddrs.clear();
+
+	//Find the addresses that are now uncovered (addrNeed = 1) and count the number of these adjacent to each stop
+	for (i = 0; i < (int)removed.size(); i++) {
+		for (a = coverSets.begin(removed[i]); a != coverSets.end(removed[i]); a++) {
+			if (addrNeed[*a]) continue;
+			for (p = walks.start[*a]; p < walks.start[*a + 1]; p++) if (stopUsed[walks.stop[p]]) break;
+			if (p < walks.start[*a + 1]) continue;
+			addrNeed[*a] = 1;
+			needAddrs.push_back(*a);
+			for (p = walks.start[*a]; p < walks.start[*a + 1]; p++) {
+				v = walks.stop[p];
+				if (v != forbidden && stopNeed[v]++ == 0) needStops.push_back(v);
+			}
+		}
+	}
+	//The stops are considered in the same order as chooseRandomSet() would
+	sort(needStops.begin(), needStops.end());
+
+	while (cnt < (int)needAddrs.size()) {
+		x = -1;
+		numChoices = 0;
+		for (i = 0; i < (int)needStops.size(); i++) {
+			if (stopNeed[needStops[i]] > 0) {
+				if (ctx.randInt(numChoices + 1) == 0) x = needStops[i];
+				numChoices++;
+			}
+		}
+		if (x == -1) { cout << "Error in repairCovering function. Ending...\n"; exit(1); }
+		//Cover the addresses adjacent to x (addrNeed = 2)
+		for (a = coverSets.begin(x); a != coverSets.end(x); a++) {
+			if (addrNeed[*a] != 1) continue;
+			addrNeed[*a] = 2;
+			cnt++;
+			for (p = walks.start[*a]; p < walks.start[*a + 1]; p++) {
+				v = walks.stop[p];
+				if (v != forbidden) stopNeed[v]--;
+			}
+		}
+		stopUsed[x] = true;
+	}
+
+	for (i = 0; i < (int)needAddrs.size(); i++) addrNeed[needAddrs[i]] = 0;
+	for (i = 0; i < (int)needStops.size(); i++) stopNeed[needStops[i]] = 0;
+
+	//If necesarry, now ensure that this covering is minimal
+	if (ctx.useMinCoverings) {
+		if (ctx.useBitCovering) makeCoveringMinimalBits(ctx, stopUsed);
+		else makeCoveringMinimal(ctx, stopUsed);
 	}
 }
 
-int makeNewCovering(SOL &S) {
+int makeNewCovering(SolverContext &ctx, SOL &S) {
 	//Delete some (non-required) stops and then repair via the set covering method
+	const vector<STOP> &stops = ctx.inst->stops;
+	vector<int> &tempVec = ctx.tempVec, &perm = ctx.perm;
 	int i;
 	
 	//Create a random permutation of the used stops that are not "required"
@@ -176,7 +372,7 @@ int makeNewCovering(SOL &S) {
 	for (i = 1; i < S.stopUsed.size(); i++) {
 		if (S.stopUsed[i] == true && !stops[i].required) tempVec.push_back(i);
 	}
-	randPermute(tempVec);
+	randPermute(ctx, tempVec);
 
 	//If all stops are required, then end (we can't change the solution)
 	if (tempVec.empty()) {
@@ -190,15 +386,15 @@ int makeNewCovering(SOL &S) {
 	perm.clear();
 	perm.push_back(tempVec[0]);
 	for (i = 1; i < tempVec.size(); i++) {
-		if (rand() / double(RAND_MAX) <= p) perm.push_back(tempVec[i]);
+		if (ctx.randUnit() <= p) perm.push_back(tempVec[i]);
 	}
 
-	//Now delete these stops from the stopUsed array and find a new minimal covering. We forbid the first stop in
-	//tempVec2 from being reselected to ensure the new set cover is different
+	//Now delete these stops from the stopUsed array and repair the covering. We forbid the first stop in
+	//perm from being reselected to ensure the new set cover is different
 	for (i = 0; i < perm.size(); i++) S.stopUsed[perm[i]] = false;
-	generateNewCovering(S.stopUsed, perm[0], 2);
+	repairCovering(ctx, S.stopUsed, perm, perm[0]);
 
 	//And finally rebuild the solution according to the new (minimal set of bus stops)
-	rebuildSolution(S);
+	rebuildSolution(ctx, S);
 	return perm.size();
 }
\ No newline at end of file
@@ -3,9 +3,9 @@
 
 #include "main.h"
 
-void getClosestStops(vector<bool> &stopUsed);
-void generateNewCovering(vector<bool> &stopUsed, int forbidden, int heuristic);
-int makeNewCovering(SOL &S);
+void getClosestStops(const SolverContext &ctx, vector<bool> &stopUsed);
+void generateNewCovering(SolverContext &ctx, vector<bool> &stopUsed, int forbidden, int heuristic);
+int makeNewCovering(SolverContext &ctx, SOL &S);
 
 #endif //SETCOVER
 
@@ -0,0 +1,61 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int numThreads) : numThreads(numThreads < 1 ? 1 : numThreads), job(NULL), jobSize(0), nextTask(0), numBusy(0), generation(0), stopping(false) {
+	for (int w = 1; w < this->numThreads; w++) workers.push_back(std::thread(&ThreadPool::workerLoop, this, w));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t w = 0; w < workers.size(); w++) workers[w].join();
+}
+
+void ThreadPool::parallelFor(int n, const std::function<void(int, int)> &task) {
+	if (n <= 0) return;
+	if (numThreads == 1) {
+		//No threads to hand the work to, so just run the loop
+		for (int i = 0; i < n; i++) task(i, 0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		job = &task;
+		jobSize = n;
+		nextTask = 0;
+		numBusy = numThreads - 1;
+		generation++;
+	}
+	wake.notify_all();
+	runTasks(0);
+	//Wait for the pool threads to finish their tasks before returning (task goes out of scope after this)
+	std::unique_lock<std::mutex> guard(lock);
+	finished.wait(guard, [this] { return numBusy == 0; });
+	job = NULL;
+}
+
+void ThreadPool::workerLoop(int worker) {
+	unsigned long seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this, seen] { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+		runTasks(worker);
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			numBusy--;
+			if (numBusy == 0) finished.notify_one();
+		}
+	}
+}
+
+void ThreadPool::runTasks(int worker) {
+	//Take tasks from the current loop until there are none left
+	int i;
+	while ((i = nextTask++) < jobSize) (*job)(i, worker);
+}
@@ -0,0 +1,42 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//A fixed set of worker threads for running loops in parallel. The thread calling parallelFor() takes part in the
+//loop as worker 0, so a pool of size n starts n - 1 threads of its own. Tasks are handed out one at a time, in
+//ascending order, to whichever worker is free. A task must not call parallelFor() on the same pool.
+class ThreadPool {
+public:
+	ThreadPool(int numThreads);
+	~ThreadPool();
+
+	//Calls task(i, w) for i = 0,...,(n - 1), where w (0 <= w < size()) identifies the worker running the call, and
+	//returns once all calls have completed
+	void parallelFor(int n, const std::function<void(int, int)> &task);
+
+	inline int size() const { return numThreads; }
+
+private:
+	int numThreads;
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;			//Signalled when a new loop is started (or the pool is closing)
+	std::condition_variable finished;		//Signalled when the last worker finishes its part of a loop
+	const std::function<void(int, int)> *job;
+	int jobSize;
+	std::atomic<int> nextTask;
+	int numBusy;							//Number of pool threads still working on the current loop
+	unsigned long generation;				//Incremented each time a loop is started
+	bool stopping;
+
+	void workerLoop(int worker);
+	void runTasks(int worker);
+};
+
+#endif //THREADPOOL_H
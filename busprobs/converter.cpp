@@ -1,4 +1,5 @@
 #include <bits/stdc++.h>
+#include "../busCode/busbin.h"
 using namespace std;
 
 using ll = long long;
@@ -135,6 +136,21 @@ int main() {
 
     fclose(fptr);
 
+    // Also write the instance in the binary .busbin format (see busCode/busbin.h) so that the solver can
+    // memory-map it instead of re-parsing the text file on every run.
+    BusBinWriter bin(num_stops, num_addr, unit, m_e, m_w);
+    for (int i = 0; i < num_stops; i++) bin.setStop(i, stops[i].longitude, stops[i].latitude, stops[i].name);
+    for (int i = 0; i < num_addr; i++) bin.setAddress(i, addrs[i].longitude, addrs[i].latitude, addrs[i].num_passengers, addrs[i].name);
+    for (int i = 0; i < num_stops; i++) {
+      for (int j = 0; j < num_stops; j++) bin.setDrive(i, j, drive[i][j].distance, drive[i][j].time);
+    }
+    for (int i = 0; i < num_addr; i++) {
+      for (auto &w : walk[i]) bin.addWalk(i, w.stop, w.distance, w.time);
+    }
+    if (!bin.write((input + ".busbin").c_str())) {
+      printf("Could not write %s.busbin\n", input.c_str());
+    }
+
     int m_t = rnd(45, 45);
     int capacity = rnd(70, 70);
     db sec_per_passenger = rndf(5, 5);